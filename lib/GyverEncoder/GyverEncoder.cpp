@@ -1,6 +1,10 @@
 #include "GyverEncoder.h"
 #include <Arduino.h>
 
+// индекс prev << 2 | state, состояние CLK | DT << 1: +1 четверть вправо, -1 влево,
+// 0 - нет изменения или невозможный переход через положение
+static const int8_t enc_table[16] = {0, 1, -1, 0, -1, 0, 0, 1, 1, 0, 0, -1, 0, -1, 1, 0};
+
 Encoder::Encoder(uint8_t clk, uint8_t dt, uint8_t sw) {
 	_CLK = clk;
 	_DT = dt;
@@ -41,6 +45,56 @@ void Encoder::setTickMode(boolean tickMode) {
 void Encoder::setFastTimeout(int timeout) {
 	fast_timeout = timeout;
 }
+void Encoder::setInterrupt(boolean isr) {
+	isrState = digitalRead(_CLK) | digitalRead(_DT) << 1;
+	quarter = 0;
+	q_tail = q_head;
+	flags.enc_isr = isr;
+}
+byte Encoder::getLost() {
+	return lost;
+}
+void Encoder::setAcceleration(const byte (*curve)[2], byte levels) {
+	accel_curve = curve;
+	accel_levels = levels;
+}
+byte Encoder::getAccel() {
+	for (byte i = 0; i < accel_levels; i++)
+		if (accel_ms <= accel_curve[i][0]) return accel_curve[i][1];
+	return 1;
+}
+
+// шаг при приходе в положение фиксации (0b11, у TYPE1 и 0b00): 1 влево, 2 вправо, 0 нет
+byte Encoder::decode(byte prev, byte state) {
+	quarter += enc_table[prev << 2 | state];
+	if (state != 0b11 && (flags.enc_type || state != 0b00)) return 0;
+	int8_t q = quarter;
+	quarter = 0;
+	// TYPE2: 3 из 4 четвертей, одна может быть пропущена (переход через положение в таблице 0);
+	// TYPE1: обе из 2, пропуск теряет шаг. Дребезг одной линии даёт +1 -1 и не считается
+	int8_t need = flags.enc_type ? 3 : 2;
+	if (q >= need) return 2;
+	if (q <= -need) return 1;
+	return 0;
+}
+
+// прерывание: только квадратура, шаги в очередь
+void Encoder::isrTick() {
+	byte state = digitalRead(_CLK) | digitalRead(_DT) << 1;
+	if (state == isrState) return;
+	byte step = decode(isrState, state);
+	isrState = state;
+	if (step == 0) return;
+	bool right = step == 2;
+
+	byte next = (q_head + 1) & (ENC_QUEUE - 1);
+	if (next == q_tail) {
+		if (lost != 0xFF) lost++;
+		return;
+	}
+	queue[q_head] = (right ? 0x8000 : 0) | (millis() & 0x7FFF);
+	q_head = next;
+}
 
 // повороты
 boolean Encoder::isTurn() {
@@ -161,31 +215,49 @@ void Encoder::tick() {
 		}
 	}
   
+	if (flags.enc_isr) {
+		// один шаг из очереди за вызов, как один шаг за опрос
+		if (q_tail != q_head) {
+			uint16_t event = queue[q_tail];	// не меняется, пока q_tail на нём
+			q_tail = (q_tail + 1) & (ENC_QUEUE - 1);
+			uint32_t now = millis();
+			turn(event & 0x8000 ? 2 : 1, now - (((uint16_t)now - event) & 0x7FFF));
+		}
+		return;
+	}
+	
 	// читаем состояние энкодера
 	curState = digitalRead(_CLK);
 	curState += digitalRead(_DT) << 1;
 	
-	if (curState != prevState && (debounceDelta > DEBOUNCE_TURN)) {		
-		encState = 0;
-		if (curState == 0b11) {
-			if (prevState == 0b10) encState = 1;
-			else if (prevState == 0b01) encState = 2;
-		} else if (curState == 0b00 && !flags.enc_type) {
-			if (prevState == 0b01) encState = 1;
-			else if (prevState == 0b10) encState = 2;
-		}
-		if (encState != 0) {
-			flags.isTurn_f = true;
-			if (millis() - fast_timer < fast_timeout) {
-				if (encState == 1) flags.isFastL_f = true;
-				else if (encState == 2) flags.isFastR_f = true;
-				fast_timer = millis();
-			} else fast_timer = millis();
-			if (flags.SW_state) encState += 2;
-		}		
+	if (curState != prevState) {		
+		encState = decode(prevState, curState);
+		if (encState != 0) turn(encState, millis());
 		prevState = curState;
 		flags.turn_flag = true;
 		debounce_timer = millis();
 		debounceDelta = 0;
 	}
+}
+
+// шаг 1 влево, 2 вправо, сделанный в момент now
+void Encoder::turn(byte state, uint32_t now) {
+	encState = state;
+	flags.isTurn_f = true;
+	uint32_t interval = now - fast_timer;
+	if (interval < (uint32_t)fast_timeout) {
+		if (encState == 1) flags.isFastL_f = true;
+		else if (encState == 2) flags.isFastR_f = true;
+	}
+	fast_timer = now;
+	
+	// скорость: среднее двух последних интервалов, смена направления или пауза - сначала
+	if (state != accel_dir || interval > 255) accel_ms = 255;
+	else accel_ms = (accel_ms + interval) / 2;
+	accel_dir = state;
+	if (flags.SW_state) encState += 2;
+	if (flags.enc_isr) {
+		flags.turn_flag = true;
+		debounce_timer = millis();
+	}
 }
\ No newline at end of file
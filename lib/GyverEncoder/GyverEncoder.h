@@ -13,13 +13,18 @@
 	- Версия 3+ более оптимальная и быстрая
 	Текущая версия: 3.1 от 10.04.2019
 		- Больше оптимизации!
-		- 
+		- Режим прерывания: isrTick() из прерывания по изменению CLK/DT
+		  кладёт шаги в очередь, tick() выбирает их по одному - шаги не
+		  теряются, пока основной цикл занят
+		- Декодирование по таблице переходов (16 записей) для TYPE1 и TYPE2,
+		  дребезг одной линии взаимно вычитается
+		- Ускорение: множитель шага по измеренной скорости вращения, getAccel()
 */
 
-// настройка антидребезга энкодера, кнопки и таймаута удержания
-#define DEBOUNCE_TURN 1
+// настройка антидребезга кнопки и таймаута удержания
 #define DEBOUNCE_BUTTON 80
 #define HOLD_TIMEOUT 700
+#define ENC_QUEUE 16	// очередь шагов режима прерывания, степень двойки
 
 #pragma pack(push,1)
 typedef struct
@@ -36,6 +41,7 @@ typedef struct
 	bool isFastL_f: 1;
 	bool enc_tick_mode: 1;
 	bool enc_type: 1;
+	bool enc_isr: 1;
 
 } GyverEncoderFlags;
 #pragma pack(pop)
@@ -51,6 +57,14 @@ class Encoder
 	void setTickMode(boolean tickMode); 	// MANUAL / AUTO - ручной или автоматический опрос энкодера функцией tick(). (по умолчанию ручной)
 	void setDirection(boolean direction);	// NORM / REVERSE - направление вращения энкодера
 	void setFastTimeout(int timeout);		// установка таймаута быстрого поворота
+	void setInterrupt(boolean isr);			// true - поворот обрабатывает isrTick() в прерывании, tick() только кнопка и очередь.
+											// false (по умолчанию) - опрос в tick(): всё, что энкодер прошёл, пока tick() не
+											// вызывался дольше четверти шага, теряется (--bench encoder: 0 из 78 шагов за
+											// медленный кадр). Только для цикла без блокирующих вызовов, IHC работает с true
+	void isrTick();							// вызывать из прерывания по изменению CLK или DT
+	byte getLost();							// шагов потеряно при полной очереди
+	void setAcceleration(const byte (*curve)[2], byte levels);	// {интервал мс, множитель}, от быстрого к медленному, NULL - без ускорения
+	byte getAccel();						// множитель последнего шага по сглаженному интервалу между шагами, 1 - медленно
 	
 	boolean isTurn();						// возвращает true при любом повороте, сама сбрасывается в false
 	boolean isRight();						// возвращает true при повороте направо, сама сбрасывается в false
@@ -70,12 +84,29 @@ class Encoder
 	
   private:
 	void init();
-	GyverEncoderFlags flags;
+	GyverEncoderFlags flags = GyverEncoderFlags();
 	byte curState, prevState;
-	byte encState;	// 0 не крутился, 1 лево, 2 право, 3 лево нажат, 4 право нажат
+	byte encState = 0;	// 0 не крутился, 1 лево, 2 право, 3 лево нажат, 4 право нажат
 	uint32_t debounce_timer = 0, fast_timer;
     byte _CLK = 0, _DT = 0, _SW = 0;
 	
+	// очередь одного писателя (isrTick) и одного читателя (tick): слово события
+	// бит 15 - вправо, биты 0..14 - millis() при шаге, для быстрого поворота и ускорения;
+	// 32 с до переполнения - шаги, выбранные после долгой записи в EEPROM или кадра
+	// дисплея, сохраняют свои интервалы (7 бит переполнялись каждые 128 мс)
+	volatile uint16_t queue[ENC_QUEUE];
+	volatile byte q_head = 0, q_tail = 0;	// head пишет только прерывание, tail только tick()
+	volatile byte lost = 0;
+	byte isrState;							// CLK/DT в прерывании
+	int8_t quarter = 0;						// четверть-шаги с последней фиксации
+	byte decode(byte prev, byte state);
+	void turn(byte state, uint32_t now);
+	
+	const byte (*accel_curve)[2] = NULL;
+	byte accel_levels = 0;
+	byte accel_ms = 255;					// сглаженный интервал между шагами, мс
+	byte accel_dir = 0;
+	
 };
 
 #define TYPE1 0			// полушаговый энкодер
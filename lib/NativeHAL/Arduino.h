@@ -0,0 +1,115 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+/*
+	Host (native) build of the small part of the Arduino core used by IHC.
+	Time, GPIO and serial are backed by NativeHAL, see NativeHAL.h for the
+	hooks used to drive them from a simulation.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+// no separate flash: F() strings are plain RAM strings
+#define PROGMEM
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+// same definition as the AVR core, returns long
+#define round(x)     ((x)>=0?(long)((x)+0.5):(long)((x)-0.5))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+void noInterrupts();
+void interrupts();
+
+// external interrupts: any pin, the handler runs when halSetPin() changes its level
+#define CHANGE 1
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+
+void setup();
+void loop();
+
+class String
+{
+  public:
+	String(const char *cstr = "");
+	String(const std::string &str);
+	explicit String(char c);
+	explicit String(unsigned char value);
+	explicit String(int value);
+	explicit String(unsigned int value);
+	explicit String(long value);
+	explicit String(unsigned long value);
+	explicit String(float value, unsigned char decimalPlaces = 2);
+	explicit String(double value, unsigned char decimalPlaces = 2);
+
+	unsigned int length() const { return buf.length(); }
+	const char *c_str() const { return buf.c_str(); }
+	void toCharArray(char *out, unsigned int bufsize, unsigned int index = 0) const;
+
+	String &operator += (const String &rhs) { buf += rhs.buf; return *this; }
+	String &operator += (const char *rhs) { buf += rhs; return *this; }
+	String &operator += (char rhs) { buf += rhs; return *this; }
+
+	friend String operator + (const String &lhs, const String &rhs) { return String(lhs.buf + rhs.buf); }
+	friend String operator + (const String &lhs, const char *rhs) { return String(lhs.buf + rhs); }
+	friend String operator + (const char *lhs, const String &rhs) { return String(lhs + rhs.buf); }
+
+  private:
+	std::string buf;
+};
+
+class HardwareSerial
+{
+  public:
+	void begin(unsigned long baud);
+	void end() {}
+	int available();
+	int availableForWrite() { return 63; }	// sent at once, the AVR TX buffer is 64 bytes
+	int read();
+	void flush() {}
+
+	size_t write(uint8_t c);
+	size_t write(const uint8_t *buffer, size_t size);
+
+	size_t print(const char *str);
+	size_t print(const __FlashStringHelper *str);
+	size_t print(const String &str);
+	size_t print(char c);
+	size_t print(unsigned char value, int base = 10);
+	size_t print(int value, int base = 10);
+	size_t print(unsigned int value, int base = 10);
+	size_t print(long value, int base = 10);
+	size_t print(unsigned long value, int base = 10);
+	size_t print(double value, int digits = 2);
+
+	template <typename T> size_t println(const T &value) { size_t n = print(value); return n + print("\r\n"); }
+	size_t println() { return print("\r\n"); }
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <Arduino.h>
+
+/*
+	Host EEPROM: 1 KB image kept in NativeHAL, erased to 0xFF like a new chip.
+	Every physical write is counted per cell (see halEepromWrites()).
+*/
+
+#define E2END 0x3FF
+
+class EEPROMClass
+{
+  public:
+	uint8_t read(int idx);
+	void write(int idx, uint8_t val);
+	void update(int idx, uint8_t val);
+	uint16_t length() { return E2END + 1; }
+
+	template <typename T> T &get(int idx, T &t)
+	{
+		uint8_t *ptr = (uint8_t *)&t;
+		for (unsigned int i = 0; i < sizeof(T); i++)
+			*ptr++ = read(idx + i);
+		return t;
+	}
+
+	template <typename T> const T &put(int idx, const T &t)
+	{
+		const uint8_t *ptr = (const uint8_t *)&t;
+		for (unsigned int i = 0; i < sizeof(T); i++)
+			update(idx + i, *ptr++);
+		return t;
+	}
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,376 @@
+#include "NativeHAL.h"
+#include <EEPROM.h>
+#include <max6675.h>
+#include <U8g2lib.h>
+#include <stdio.h>
+#include <deque>
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+const u8g2_cb_t u8g2_cb_r0 = { 0 };
+const u8g2_cb_t u8g2_cb_r2 = { 2 };
+const uint8_t u8g2_font_6x10_tf[] = { 0 };
+
+static uint64_t clock_us = 0;
+static HalTimeHook time_hook = NULL;
+static void *time_ctx = NULL;
+
+// constant-initialised: global constructors (Encoder) read pins before main()
+static uint8_t pin_level[HAL_PINS] = {
+	HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH,
+	HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH
+};
+static HalPinHook pin_hook = NULL;
+static void *pin_ctx = NULL;
+static void (*pin_isr[HAL_PINS])(void);
+
+static HalThermoSource thermo_source = NULL;
+static void *thermo_ctx = NULL;
+
+static HalDisplayStats display_stats;
+static std::vector<std::string> display_frame, display_last;
+static uint32_t display_page_us;
+static uint32_t display_draw_us;
+
+static uint8_t eeprom_image[E2END + 1];
+static uint32_t eeprom_writes[E2END + 1];
+
+static HalSerialSink serial_sink = NULL;
+static void *serial_ctx = NULL;
+static bool serial_mute = false;
+static std::deque<uint8_t> serial_rx;
+
+/////////////////////////////////////////////////////////////////////////////////clock
+void halReset()
+{
+	clock_us = 0;
+	time_hook = NULL;
+	for (uint8_t i = 0; i < HAL_PINS; i++)
+		pin_level[i] = HIGH;
+	pin_hook = NULL;
+	memset(pin_isr, 0, sizeof(pin_isr));
+	thermo_source = NULL;
+	display_stats = HalDisplayStats();
+	display_frame.clear();
+	display_last.clear();
+	display_page_us = HAL_PAGE_US;
+	display_draw_us = HAL_DRAW_US;
+	memset(eeprom_image, 0xFF, sizeof(eeprom_image));
+	memset(eeprom_writes, 0, sizeof(eeprom_writes));
+	serial_sink = NULL;
+	serial_rx.clear();
+}
+
+void halSetMicros(uint64_t us)
+{
+	clock_us = us;
+	if (time_hook) time_hook((uint32_t)clock_us, time_ctx);
+}
+
+void halAdvanceMicros(uint32_t us)
+{
+	halSetMicros(clock_us + us);
+}
+
+uint64_t halMicros64() { return clock_us; }
+
+void halOnTimeAdvance(HalTimeHook hook, void *ctx)
+{
+	time_hook = hook;
+	time_ctx = ctx;
+}
+
+// no 32-bit wraparound: unsigned long is 64 bits here, so the firmware's
+// now - then, which wraps correctly on the AVR, would jump by 2^32 at it
+unsigned long millis() { return (unsigned long)(clock_us / 1000); }
+unsigned long micros() { return (unsigned long)clock_us; }
+
+void delay(unsigned long ms)
+{
+	// advance in 1 ms steps so time hooks (plant models) keep integrating
+	while (ms--)
+		halAdvanceMicros(1000);
+}
+
+void delayMicroseconds(unsigned int us) { halAdvanceMicros(us); }
+
+void noInterrupts() {}
+void interrupts() {}
+
+/////////////////////////////////////////////////////////////////////////////////GPIO
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	if (pin < HAL_PINS && mode == INPUT_PULLUP)
+		pin_level[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	if (pin >= HAL_PINS) return;
+	pin_level[pin] = val ? HIGH : LOW;
+	if (pin_hook) pin_hook(pin, pin_level[pin], pin_ctx);
+}
+
+int digitalRead(uint8_t pin)
+{
+	return pin < HAL_PINS ? pin_level[pin] : LOW;
+}
+
+void halSetPin(uint8_t pin, uint8_t val)
+{
+	if (pin >= HAL_PINS) return;
+	uint8_t level = val ? HIGH : LOW;
+	if (level == pin_level[pin]) return;
+	pin_level[pin] = level;
+	if (pin_isr[pin]) pin_isr[pin]();
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode)
+{
+	(void)mode;	// CHANGE only
+	if (interruptNum < HAL_PINS) pin_isr[interruptNum] = userFunc;
+}
+
+void detachInterrupt(uint8_t interruptNum)
+{
+	if (interruptNum < HAL_PINS) pin_isr[interruptNum] = NULL;
+}
+
+uint8_t halGetPin(uint8_t pin)
+{
+	return pin < HAL_PINS ? pin_level[pin] : LOW;
+}
+
+void halOnPinWrite(HalPinHook hook, void *ctx)
+{
+	pin_hook = hook;
+	pin_ctx = ctx;
+}
+
+/////////////////////////////////////////////////////////////////////////////////MAX6675
+void halSetThermocouple(HalThermoSource source, void *ctx)
+{
+	thermo_source = source;
+	thermo_ctx = ctx;
+}
+
+MAX6675::MAX6675(int8_t SCLK, int8_t CS, int8_t MISO)
+{
+	sclk = SCLK;
+	cs = CS;
+	miso = MISO;
+}
+
+double MAX6675::readCelsius()
+{
+	return thermo_source ? thermo_source(thermo_ctx) : 25.0;
+}
+
+double MAX6675::readFahrenheit()
+{
+	return readCelsius() * 9.0 / 5.0 + 32;
+}
+
+/////////////////////////////////////////////////////////////////////////////////display
+void U8G2::begin() {}
+
+void U8G2::firstPage()
+{
+	page = 0;
+	display_frame.clear();
+	display_stats.pages++;
+}
+
+uint8_t U8G2::nextPage()
+{
+	if (display_page_us)
+		halAdvanceMicros(display_page_us);
+	if (++page < U8G2_PAGE_COUNT)
+	{
+		display_stats.pages++;
+		return 1;
+	}
+	display_stats.frames++;
+	display_last.swap(display_frame);
+	return 0;
+}
+
+static void drawn()
+{
+	display_stats.draws++;
+	if (display_draw_us)
+		halAdvanceMicros(display_draw_us);
+}
+
+uint16_t U8G2::drawStr(int16_t x, int16_t y, const char *s)
+{
+	drawn();
+	if (page == 0)
+	{
+		char pos[16];
+		snprintf(pos, sizeof(pos), "%d,%d ", x, y);
+		display_frame.push_back(std::string(pos) + s);
+	}
+	return strlen(s) * 6;
+}
+
+void U8G2::drawBox(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+	(void)x; (void)y; (void)w; (void)h;
+	drawn();
+}
+
+void U8G2::drawLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2)
+{
+	(void)x1; (void)y1; (void)x2; (void)y2;
+	drawn();
+}
+
+const HalDisplayStats &halDisplayStats() { return display_stats; }
+const std::vector<std::string> &halDisplayLastFrame() { return display_last; }
+void halDisplayPageMicros(uint32_t us) { display_page_us = us; }
+void halDisplayDrawMicros(uint32_t us) { display_draw_us = us; }
+
+/////////////////////////////////////////////////////////////////////////////////EEPROM
+uint8_t EEPROMClass::read(int idx)
+{
+	return eeprom_image[idx & E2END];
+}
+
+void EEPROMClass::write(int idx, uint8_t val)
+{
+	eeprom_image[idx & E2END] = val;
+	eeprom_writes[idx & E2END]++;
+}
+
+void EEPROMClass::update(int idx, uint8_t val)
+{
+	if (read(idx) != val)
+		write(idx, val);
+}
+
+uint8_t *halEeprom() { return eeprom_image; }
+uint32_t halEepromWrites(int idx) { return eeprom_writes[idx & E2END]; }
+
+bool halEepromLoad(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f) return false;
+	size_t n = fread(eeprom_image, 1, sizeof(eeprom_image), f);
+	fclose(f);
+	return n == sizeof(eeprom_image);
+}
+
+bool halEepromSave(const char *path)
+{
+	FILE *f = fopen(path, "wb");
+	if (!f) return false;
+	size_t n = fwrite(eeprom_image, 1, sizeof(eeprom_image), f);
+	fclose(f);
+	return n == sizeof(eeprom_image);
+}
+
+/////////////////////////////////////////////////////////////////////////////////serial
+void halSerialSink(HalSerialSink sink, void *ctx)
+{
+	serial_sink = sink;
+	serial_ctx = ctx;
+}
+
+void halSerialMute(bool mute) { serial_mute = mute; }
+
+void halSerialInject(const char *data, size_t len)
+{
+	serial_rx.insert(serial_rx.end(), data, data + len);
+}
+
+void HardwareSerial::begin(unsigned long baud) { (void)baud; }
+
+int HardwareSerial::available() { return serial_rx.size(); }
+
+int HardwareSerial::read()
+{
+	if (serial_rx.empty()) return -1;
+	uint8_t c = serial_rx.front();
+	serial_rx.pop_front();
+	return c;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+	if (serial_sink)
+		serial_sink(buffer, size, serial_ctx);
+	else if (!serial_mute)
+		fwrite(buffer, 1, size, stdout);
+	return size;
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+static size_t printNumber(HardwareSerial &s, unsigned long n, bool neg, int base)
+{
+	char buf[8 * sizeof(long) + 2];
+	char *p = &buf[sizeof(buf)];
+	if (base < 2) base = 10;
+	do {
+		unsigned long d = n % base;
+		*--p = d < 10 ? '0' + d : 'A' + d - 10;
+		n /= base;
+	} while (n);
+	if (neg) *--p = '-';
+	return s.write((const uint8_t *)p, &buf[sizeof(buf)] - p);
+}
+
+size_t HardwareSerial::print(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+size_t HardwareSerial::print(const __FlashStringHelper *str) { return print((const char *)str); }
+size_t HardwareSerial::print(const String &str) { return print(str.c_str()); }
+size_t HardwareSerial::print(char c) { return write((uint8_t)c); }
+size_t HardwareSerial::print(unsigned char value, int base) { return printNumber(*this, value, false, base); }
+size_t HardwareSerial::print(unsigned int value, int base) { return printNumber(*this, value, false, base); }
+size_t HardwareSerial::print(unsigned long value, int base) { return printNumber(*this, value, false, base); }
+size_t HardwareSerial::print(int value, int base) { return print((long)value, base); }
+
+size_t HardwareSerial::print(long value, int base)
+{
+	if (base == 10 && value < 0)
+		return printNumber(*this, -(unsigned long)value, true, 10);
+	return printNumber(*this, (unsigned long)value, false, base);
+}
+
+size_t HardwareSerial::print(double value, int digits)
+{
+	return print(String(value, digits));
+}
+
+/////////////////////////////////////////////////////////////////////////////////String
+String::String(const char *cstr) : buf(cstr ? cstr : "") {}
+String::String(const std::string &str) : buf(str) {}
+String::String(char c) : buf(1, c) {}
+String::String(unsigned char value) : buf(std::to_string((unsigned)value)) {}
+String::String(int value) : buf(std::to_string(value)) {}
+String::String(unsigned int value) : buf(std::to_string(value)) {}
+String::String(long value) : buf(std::to_string(value)) {}
+String::String(unsigned long value) : buf(std::to_string(value)) {}
+String::String(float value, unsigned char decimalPlaces) : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned char decimalPlaces)
+{
+	char tmp[40];
+	snprintf(tmp, sizeof(tmp), "%.*f", decimalPlaces, value);
+	buf = tmp;
+}
+
+void String::toCharArray(char *out, unsigned int bufsize, unsigned int index) const
+{
+	if (!bufsize || !out) return;
+	if (index >= buf.length())
+	{
+		out[0] = 0;
+		return;
+	}
+	unsigned int n = bufsize - 1;
+	if (n > buf.length() - index) n = buf.length() - index;
+	memcpy(out, buf.c_str() + index, n);
+	out[n] = 0;
+}
@@ -0,0 +1,70 @@
+#ifndef NativeHAL_h
+#define NativeHAL_h
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+/*
+	NativeHAL - thin hardware abstraction for running the IHC firmware on a
+	workstation. The firmware keeps calling the Arduino API; on the native
+	target those calls land here:
+	- clock: millis()/micros()/delay() read a fake clock that only moves
+	  when the harness (or delay()) advances it
+	- GPIO: digitalWrite() latches levels, digitalRead() returns levels
+	  injected by the harness (inputs idle HIGH, as with pull-ups);
+	  attachInterrupt() handlers run on injected level changes
+	- SPI thermocouple: MAX6675::readCelsius() asks an installed source
+	- display sink: U8g2 page loops are counted, strings are captured;
+	  every draw call and sent page moves the clock by its AVR cost
+	- nonvolatile storage: 1 KB EEPROM image with per-cell write counters
+*/
+
+#define HAL_PINS 32
+#define HAL_PAGE_US 3000	// 128-byte page on the 400 kHz I2C u8g2 runs the SH1106 at
+#define HAL_DRAW_US 100	// a string or line rasterised into the page buffer at 16 MHz, estimate
+
+typedef void (*HalTimeHook)(uint32_t now_us, void *ctx);	// called after every clock advance
+typedef void (*HalPinHook)(uint8_t pin, uint8_t val, void *ctx);	// called on every digitalWrite
+typedef double (*HalThermoSource)(void *ctx);				// value returned by readCelsius()
+typedef void (*HalSerialSink)(const uint8_t *data, size_t len, void *ctx);
+
+struct HalDisplayStats {
+	uint32_t frames;		// completed firstPage()/nextPage() loops
+	uint32_t pages;			// page passes
+	uint32_t draws;			// draw calls, summed over all pages
+};
+
+// clock
+void halReset();							// time to 0, pins idle, EEPROM erased, hooks removed
+void halSetMicros(uint64_t us);
+void halAdvanceMicros(uint32_t us);
+uint64_t halMicros64();
+void halOnTimeAdvance(HalTimeHook hook, void *ctx);
+
+// GPIO
+void halSetPin(uint8_t pin, uint8_t val);	// level seen by digitalRead()
+uint8_t halGetPin(uint8_t pin);				// level last written/set
+void halOnPinWrite(HalPinHook hook, void *ctx);
+
+// thermocouple
+void halSetThermocouple(HalThermoSource source, void *ctx);
+
+// display
+const HalDisplayStats &halDisplayStats();
+const std::vector<std::string> &halDisplayLastFrame();
+void halDisplayPageMicros(uint32_t us);		// clock advance per sent page (bus time), default HAL_PAGE_US
+void halDisplayDrawMicros(uint32_t us);		// clock advance per draw call, default HAL_DRAW_US
+
+// EEPROM
+uint8_t *halEeprom();
+uint32_t halEepromWrites(int idx);
+bool halEepromLoad(const char *path);
+bool halEepromSave(const char *path);
+
+// serial
+void halSerialSink(HalSerialSink sink, void *ctx);	// NULL restores stdout
+void halSerialMute(bool mute);
+void halSerialInject(const char *data, size_t len);
+
+#endif
@@ -0,0 +1,150 @@
+#include "ThermalPlant.h"
+#include <math.h>
+
+#define STEP_US 1000UL		// integration step
+#define HISTORY_US 10000UL	// dead time resolution
+
+ThermalPlant::ThermalPlant(uint8_t heaterPin)
+{
+	pin = heaterPin;
+	p = defaults();
+	reset();
+}
+
+ThermalPlant::ThermalPlant(uint8_t heaterPin, const PlantParams &params)
+{
+	pin = heaterPin;
+	p = params;
+	reset();
+}
+
+/**
+ * @brief 4 mm duralumin sheet over a kitchen IR hob, as in DOC/README_RU.md
+ * (reaches 200 C in a little under 2 minutes)
+ */
+PlantParams ThermalPlant::defaults()
+{
+	PlantParams d;
+	d.power = 600;
+	d.mass = 300;
+	d.loss = 1.5;
+	d.ambient = 25;
+	d.dead_time = 3;
+	d.sensor_tau = 2;
+	d.noise = 0;
+	d.conversion = 0.22;
+	d.glitch = 0;
+	return d;
+}
+
+void ThermalPlant::reset()
+{
+	t_us = halMicros64();
+	on_us = 0;
+	heater_on = false;
+	T_plate = T_sensor = p.ambient;
+	delay_line.assign((size_t)(p.dead_time * 1e6 / HISTORY_US) + 1, p.ambient);
+	delay_pos = 0;
+	seed = 1;
+	conversion_us = t_us;
+	result = floor(p.ambient * 4) / 4;
+	read_count = stale_count = 0;
+}
+
+void ThermalPlant::attach()
+{
+	halOnTimeAdvance(timeHook, this);
+	halOnPinWrite(pinHook, this);
+	halSetThermocouple(thermoSource, this);
+	reset();
+}
+
+void ThermalPlant::advanceTo(uint64_t us)
+{
+	while (t_us < us)
+	{
+		uint64_t dt_us = us - t_us;
+		uint64_t to_history = HISTORY_US - t_us % HISTORY_US;
+		if (dt_us > STEP_US) dt_us = STEP_US;
+		if (dt_us > to_history) dt_us = to_history;
+		double dt = dt_us / 1e6;
+
+		// exact solution of the first order plate over one step
+		double T_final = p.ambient + (heater_on ? p.power : 0) / p.loss;
+		T_plate = T_final + (T_plate - T_final) * exp(-p.loss / p.mass * dt);
+
+		double T_seen = delay_line[delay_pos];
+		if (p.sensor_tau > 0)
+			T_sensor = T_seen + (T_sensor - T_seen) * exp(-dt / p.sensor_tau);
+		else
+			T_sensor = T_seen;
+
+		if (heater_on) on_us += dt_us;
+		t_us += dt_us;
+
+		if (t_us % HISTORY_US == 0)
+		{
+			delay_line[delay_pos] = T_plate;
+			delay_pos = (delay_pos + 1) % delay_line.size();
+		}
+	}
+}
+
+double ThermalPlant::random()
+{
+	seed = seed * 1103515245UL + 12345UL;
+	return ((seed >> 8) & 0xFFFF) / 65535.0 - 0.5;
+}
+
+double ThermalPlant::readCelsius()
+{
+	uint64_t now = halMicros64();
+	advanceTo(now);
+	read_count++;
+
+	if (now - conversion_us >= (uint64_t)(p.conversion * 1e6))
+	{
+		double T = T_sensor;
+		if (p.noise > 0)
+		{
+			// sum of uniforms, close enough to gaussian for sensor noise
+			double n = 0;
+			for (uint8_t i = 0; i < 4; i++)
+				n += random();
+			T += n * p.noise * sqrt(3.0);
+		}
+		if (T < 0) T = 0;
+		if (T > 1023.75) T = 1023.75;
+		result = floor(T * 4) / 4;
+	}
+	else
+		stale_count++;
+	conversion_us = now;
+
+	if (p.glitch > 0 && random() + 0.5 < p.glitch)
+	{
+		uint16_t bit = 1 << (uint16_t)((random() + 0.5) * 11.99);
+		return ((uint16_t)(result * 4) ^ bit) / 4.0;
+	}
+	return result;
+}
+
+void ThermalPlant::timeHook(uint32_t now_us, void *ctx)
+{
+	(void)now_us;
+	ThermalPlant *plant = (ThermalPlant *)ctx;
+	plant->advanceTo(halMicros64());
+}
+
+void ThermalPlant::pinHook(uint8_t pin, uint8_t val, void *ctx)
+{
+	ThermalPlant *plant = (ThermalPlant *)ctx;
+	if (pin != plant->pin) return;
+	plant->advanceTo(halMicros64());
+	plant->heater_on = val;
+}
+
+double ThermalPlant::thermoSource(void *ctx)
+{
+	return ((ThermalPlant *)ctx)->readCelsius();
+}
@@ -0,0 +1,73 @@
+#ifndef ThermalPlant_h
+#define ThermalPlant_h
+
+#include "NativeHAL.h"
+#include <vector>
+
+/*
+	ThermalPlant - IR heater under an aluminium plate, for closed-loop runs
+	on the native target. The heater is on/off, driven by the level of the
+	relay pin; the plate is a single thermal mass losing heat to ambient:
+
+		C * dT/dt = P * heater - h * (T - T_ambient)
+
+	The thermocouple sees the plate through a transport delay and a first
+	order lag, and is read like a MAX6675 (0.25 C steps, truncated). As on
+	the chip, a read stops the conversion in progress and starts a new one:
+	a read before it ends gets the previous result again.
+	Time comes from the NativeHAL clock, so a run is as fast as the host.
+*/
+
+struct PlantParams {
+	double power;		// W delivered to the plate with the heater on
+	double mass;		// J/K, heat capacity of plate + load
+	double loss;		// W/K, loss to ambient
+	double ambient;		// C
+	double dead_time;	// s, transport delay heater -> thermocouple
+	double sensor_tau;	// s, thermocouple lag, 0 - none
+	double noise;		// C, rms noise added before quantization, 0 - none
+	double conversion;	// s, MAX6675 conversion time
+	double glitch;		// fraction of reads with one of the 12 data bits flipped on the bus
+};
+
+class ThermalPlant
+{
+  public:
+	ThermalPlant(uint8_t heaterPin);
+	ThermalPlant(uint8_t heaterPin, const PlantParams &params);
+
+	void attach();				// installs the NativeHAL hooks
+	void reset();				// everything back to ambient, clock reference = now
+
+	double plate() const { return T_plate; }
+	double sensor() const { return T_sensor; }
+	double readCelsius();		// what MAX6675::readCelsius() returns
+	bool heater() const { return heater_on; }
+	double heaterOnSeconds() const { return on_us / 1e6; }
+	uint32_t reads() const { return read_count; }
+	uint32_t staleReads() const { return stale_count; }	// read during a conversion
+
+	const PlantParams &params() const { return p; }
+	static PlantParams defaults();
+
+  private:
+	static void timeHook(uint32_t now_us, void *ctx);
+	static void pinHook(uint8_t pin, uint8_t val, void *ctx);
+	static double thermoSource(void *ctx);
+	void advanceTo(uint64_t us);
+
+	PlantParams p;
+	uint8_t pin;
+	bool heater_on;
+	uint64_t t_us, on_us;
+	double T_plate, T_sensor;
+	uint64_t conversion_us;		// start of the conversion in progress
+	double result;				// last finished conversion
+	uint32_t read_count, stale_count;
+	std::vector<double> delay_line;	// plate temperature every HISTORY_US
+	size_t delay_pos;
+	uint32_t seed;
+	double random();			// -0.5..0.5
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef U8G2LIB_HH
+#define U8G2LIB_HH
+
+#include <Arduino.h>
+
+/*
+	Host U8g2: a display sink with the page-mode API used by IHC.
+	Nothing is rasterised, the calls are counted and the strings of the
+	last complete frame are kept for inspection (see NativeHAL.h).
+*/
+
+#define U8X8_PIN_NONE 255
+#define U8G2_PAGE_COUNT 8
+
+typedef struct { uint8_t rotation; } u8g2_cb_t;
+extern const u8g2_cb_t u8g2_cb_r0;
+extern const u8g2_cb_t u8g2_cb_r2;
+#define U8G2_R0 (&u8g2_cb_r0)
+#define U8G2_R2 (&u8g2_cb_r2)
+
+extern const uint8_t u8g2_font_6x10_tf[];
+
+class U8G2
+{
+  public:
+	void begin();
+
+	void firstPage();
+	uint8_t nextPage();
+
+	void setFontMode(uint8_t is_transparent) { (void)is_transparent; }
+	void setFont(const uint8_t *font) { (void)font; }
+	void setDrawColor(uint8_t color) { (void)color; }
+
+	uint16_t drawStr(int16_t x, int16_t y, const char *s);
+	uint16_t drawUTF8(int16_t x, int16_t y, const char *s) { return drawStr(x, y, s); }
+	void drawBox(int16_t x, int16_t y, int16_t w, int16_t h);
+	void drawFrame(int16_t x, int16_t y, int16_t w, int16_t h) { drawBox(x, y, w, h); }
+	void drawLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+
+	uint8_t getCurrentPage() { return page; }
+
+  private:
+	uint8_t page;
+};
+
+class U8G2_SH1106_128X64_NONAME_1_HW_I2C : public U8G2
+{
+  public:
+	U8G2_SH1106_128X64_NONAME_1_HW_I2C(const u8g2_cb_t *rotation, uint8_t reset, uint8_t clock, uint8_t data)
+	{
+		(void)rotation; (void)reset; (void)clock; (void)data;
+	}
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef MAX6675_h
+#define MAX6675_h
+
+#include <Arduino.h>
+
+/*
+	Host MAX6675: the temperature comes from the source installed with
+	halSetThermocouple() (a fixed 25 C when nothing is installed).
+*/
+
+class MAX6675
+{
+  public:
+	MAX6675(int8_t SCLK, int8_t CS, int8_t MISO);
+
+	double readCelsius();
+	double readFahrenheit();
+
+  private:
+	int8_t sclk, miso, cs;
+};
+
+#endif
@@ -0,0 +1,286 @@
+#ifndef PID_fixed_h
+#define PID_fixed_h
+
+#if ARDUINO >= 100
+  #include "Arduino.h"
+#else
+  #include "WProgram.h"
+#endif
+#include <stdint.h>
+#include <PID_my.h>
+
+/*
+	PIDFixed - the PID class with its arithmetic in fixed point.
+
+	Same API as PID (the double pointers are converted once per Compute),
+	selected at compile time with -DPID_FIXED=16 for Q16.16 (15 works too).
+	Gains, ITerm and error live in int32 Q(31-FRAC).FRAC and all the
+	arithmetic is 32-bit: a product is built from the integer and fraction
+	halves of its operands (four 32-bit multiplies instead of a 64-bit
+	one, which is a libgcc call on AVR), sums and products saturate
+	instead of wrapping, so large kp*error or kd*dErr are clamped to the
+	output limits like in PID.
+
+	Range: Input, Setpoint, the feed-forward and the output limits must be
+	within +-2^(30-FRAC) (+-16383 for Q16.16); gains up to 2^(31-FRAC)
+	after the sample time scaling, larger ones saturate.
+
+	Tolerance against PID with the same inputs (native runner, --bench pid):
+	each gain is rounded to 2^-FRAC, so the integral drifts from the double
+	version by at most 2^-(FRAC+1) * sum|error|; kd is divided by the
+	elapsed ms before the product, truncating it by under 2^-FRAC. With Q16.16 and the IHC
+	defaults (ki = 0.025 per sample) that is a relative error of 3e-4 on
+	ITerm; over a full profile the output stays within 0.2 of PID, i.e.
+	under 0.2 ms of a 500 ms heater window.
+*/
+
+template <uint8_t FRAC>
+class PIDFixed
+{
+	static_assert(FRAC >= 15 && FRAC <= 16, "the 32-bit products need FRAC 15 or 16");
+
+  public:
+	typedef int32_t fixed;
+
+	PIDFixed(double*, double*, double*,	// * same parameters as PID
+	         double, double, double, int);
+
+	void SetMode(int Mode);
+	bool Compute();
+	void SetOutputLimits(double, double);
+	void SetTunings(double, double, double);
+	void SetTuningsBumpless(double, double, double);
+	void SetControllerDirection(int);
+	void SetSampleTime(int);
+	void SetFeedForward(double* FeedForward) { myFeedForward = FeedForward; }
+
+	double GetKp() { return dispKp; }
+	double GetKi() { return dispKi; }
+	double GetKd() { return dispKd; }
+	int GetMode() { return inAuto ? AUTOMATIC : MANUAL; }
+	int GetDirection() { return controllerDirection; }
+
+	static fixed toFixed(double v) { v = ldexp(v, FRAC); return (fixed)(v >= 0 ? v + 0.5 : v - 0.5); }
+	static double toDouble(int32_t v) { return (double)v / (double)(1L << FRAC); }
+	static fixed toGain(double v) { return v >= toDouble(INT32_MAX) ? INT32_MAX : toFixed(v); }
+	static fixed add(fixed a, fixed b);
+	static fixed mul(fixed a, fixed b);
+
+  private:
+	void Initialize();
+	fixed clamp(fixed v, fixed feed = 0) { return v > outMax - feed ? outMax - feed : (v < outMin - feed ? outMin - feed : v); }
+
+	double dispKp, dispKi, dispKd;
+	fixed kp, ki, kd;
+
+	int controllerDirection;
+
+	double *myInput;
+	double *myOutput;
+	double *mySetpoint;
+	double *myFeedForward;
+
+	unsigned long lastTime;
+	fixed ITerm, lastError;
+
+	unsigned long SampleTime;
+	fixed outMin, outMax;
+	bool inAuto;
+};
+
+/*Constructor (...)*********************************************************
+ *    same defaults as PID: limits 0-255, 250 ms sample time
+ ***************************************************************************/
+template <uint8_t FRAC>
+PIDFixed<FRAC>::PIDFixed(double* Input, double* Output, double* Setpoint,
+        double Kp, double Ki, double Kd, int ControllerDirection)
+{
+	myOutput = Output;
+	myInput = Input;
+	mySetpoint = Setpoint;
+	myFeedForward = NULL;
+	inAuto = false;
+	ITerm = 0;
+	lastError = 0;
+
+	SetOutputLimits(0, 255);
+	SampleTime = 250;
+
+	controllerDirection = DIRECT;
+	SetControllerDirection(ControllerDirection);
+	SetTunings(Kp, Ki, Kd);
+
+	lastTime = millis()-SampleTime;
+}
+
+/* add(...), mul(...) *********************************************************
+ *   a + b and a * b in Q(31-FRAC).FRAC, saturated to +-INT32_MAX. The product
+ *   splits the magnitudes into integer (h) and fraction (l) halves:
+ *     |a*b| = (ah*bh << FRAC) + ah*bl + al*bh + (al*bl >> FRAC)
+ *   al*bl fits 32 bits with FRAC <= 16 and ah*bh with FRAC >= 15; the sum is
+ *   under (ah+1)*(bh+1) << FRAC, which is checked against 2^31 first.
+ ******************************************************************************/
+template <uint8_t FRAC>
+typename PIDFixed<FRAC>::fixed PIDFixed<FRAC>::add(fixed a, fixed b)
+{
+	if(b > 0 && a > INT32_MAX - b) return INT32_MAX;
+	if(b < 0 && a < -INT32_MAX - b) return -INT32_MAX;
+	return a + b;
+}
+
+template <uint8_t FRAC>
+typename PIDFixed<FRAC>::fixed PIDFixed<FRAC>::mul(fixed a, fixed b)
+{
+	const uint32_t FRACTION = (1UL << FRAC) - 1, LIMIT = 1UL << (31 - FRAC);
+	bool negative = (a < 0) != (b < 0);
+	uint32_t ua = a < 0 ? 0 - (uint32_t)a : (uint32_t)a;
+	uint32_t ub = b < 0 ? 0 - (uint32_t)b : (uint32_t)b;
+	uint32_t ah = ua >> FRAC, al = ua & FRACTION, bh = ub >> FRAC, bl = ub & FRACTION;
+
+	uint32_t hh = ah * bh;
+	if(hh >= LIMIT || ah + bh + 1 > LIMIT - hh) return negative ? -INT32_MAX : INT32_MAX;
+	uint32_t p = (hh << FRAC) + ah * bl + al * bh + ((al * bl) >> FRAC);
+	return negative ? -(fixed)p : (fixed)p;
+}
+
+/* Compute() **********************************************************************
+ *     Same control law as PID::Compute(): integral clamped to the output
+ *   limits less the feed-forward, derivative of the error divided by the
+ *   elapsed milliseconds.
+ **********************************************************************************/
+template <uint8_t FRAC>
+bool PIDFixed<FRAC>::Compute()
+{
+	if(!inAuto) return false;
+	unsigned long now = millis();
+	unsigned long timeChange = (now - lastTime);
+	if(timeChange>=SampleTime)
+	{
+		fixed error = toFixed(*mySetpoint - *myInput);
+		fixed feed = myFeedForward ? toFixed(*myFeedForward) : 0;
+
+		ITerm = clamp(add(ITerm, mul(ki, error)), feed);
+
+		fixed dTerm = mul(kd / (int32_t)timeChange, error - lastError);	// divided first: a saturated product is in output units
+
+		fixed output = add(add(add(feed, mul(kp, error)), ITerm), dTerm);
+		*myOutput = toDouble(clamp(output));
+
+		lastTime = now;
+		lastError = error;
+		return true;
+	}
+	else return false;
+}
+
+/* SetTunings(...)*************************************************************
+ * gains are scaled by the sample time like PID, then rounded to 2^-FRAC;
+ * a gain past the fixed range (Q16.16: Kd over 8191 at 250 ms) saturates
+ ******************************************************************************/
+template <uint8_t FRAC>
+void PIDFixed<FRAC>::SetTunings(double Kp, double Ki, double Kd)
+{
+	if (Kp<0 || Ki<0 || Kd<0) return;
+
+	dispKp = Kp; dispKi = Ki; dispKd = Kd;
+
+	double SampleTimeInSec = ((double)SampleTime)/1000;
+	kp = toGain(Kp);
+	ki = toGain(Ki * SampleTimeInSec);
+	kd = toGain(Kd / SampleTimeInSec);
+
+	if(controllerDirection ==REVERSE)
+	{
+		kp = (0 - kp);
+		ki = (0 - ki);
+		kd = (0 - kd);
+	}
+}
+
+/* SetTuningsBumpless(...)*****************************************************
+ * see PID
+ ******************************************************************************/
+template <uint8_t FRAC>
+void PIDFixed<FRAC>::SetTuningsBumpless(double Kp, double Ki, double Kd)
+{
+	fixed oldKp = kp;
+	SetTunings(Kp, Ki, Kd);
+	if(!inAuto) return;
+
+	fixed feed = myFeedForward ? toFixed(*myFeedForward) : 0;
+	fixed error = toFixed(*mySetpoint - *myInput);
+	ITerm = clamp(add(ITerm, mul(oldKp - kp, error)), feed);
+}
+
+/* SetSampleTime(...) *********************************************************
+ * sets the period, in Milliseconds, at which the calculation is performed
+ ******************************************************************************/
+template <uint8_t FRAC>
+void PIDFixed<FRAC>::SetSampleTime(int NewSampleTime)
+{
+	if (NewSampleTime > 0)
+	{
+		SampleTime = (unsigned long)NewSampleTime;
+		SetTunings(dispKp, dispKi, dispKd);
+	}
+}
+
+/* SetOutputLimits(...)****************************************************
+ * limits must be within +-2^(30-FRAC), i.e. +-16383 for Q16.16
+ **************************************************************************/
+template <uint8_t FRAC>
+void PIDFixed<FRAC>::SetOutputLimits(double Min, double Max)
+{
+	if(Min >= Max) return;
+	outMin = toFixed(Min);
+	outMax = toFixed(Max);
+
+	if(inAuto)
+	{
+		if(*myOutput > Max) *myOutput = Max;
+		else if(*myOutput < Min) *myOutput = Min;
+
+		ITerm = clamp(ITerm);
+	}
+}
+
+/* SetMode(...)****************************************************************
+ * Allows the controller Mode to be set to manual (0) or Automatic (non-zero)
+ ******************************************************************************/
+template <uint8_t FRAC>
+void PIDFixed<FRAC>::SetMode(int Mode)
+{
+	bool newAuto = (Mode == AUTOMATIC);
+	if(newAuto == !inAuto)
+	{  /*we just went from manual to auto*/
+		Initialize();
+	}
+	inAuto = newAuto;
+}
+
+/* Initialize()****************************************************************
+ *	bumpless transfer from manual to automatic mode
+ ******************************************************************************/
+template <uint8_t FRAC>
+void PIDFixed<FRAC>::Initialize()
+{
+	fixed feed = myFeedForward ? toFixed(*myFeedForward) : 0;
+	ITerm = clamp(toFixed(*myOutput) - feed, feed);
+}
+
+/* SetControllerDirection(...)*************************************************
+ * DIRECT or REVERSE acting process, see PID
+ ******************************************************************************/
+template <uint8_t FRAC>
+void PIDFixed<FRAC>::SetControllerDirection(int Direction)
+{
+	if(inAuto && Direction !=controllerDirection)
+	{
+		kp = (0 - kp);
+		ki = (0 - ki);
+		kd = (0 - kd);
+	}
+	controllerDirection = Direction;
+}
+
+#endif
@@ -24,6 +24,7 @@ PID::PID(double* Input, double* Output, double* Setpoint,
     myOutput = Output;
     myInput = Input;
     mySetpoint = Setpoint;
+    myFeedForward = NULL;
 	inAuto = false;
 	
 	PID::SetOutputLimits(0, 255);				//default output limit corresponds to 
@@ -54,13 +55,14 @@ bool PID::Compute()
       /*Compute all the working error variables*/
 	  double input = *myInput;
       double error = *mySetpoint - input;
+      double feed = myFeedForward ? *myFeedForward : 0;
       ITerm+= (ki * error);
-      if(ITerm > outMax) ITerm= outMax;
-      else if(ITerm < outMin) ITerm= outMin;
+      if(ITerm > outMax - feed) ITerm= outMax - feed;
+      else if(ITerm < outMin - feed) ITerm= outMin - feed;
      // double dInput = (input - lastInput);
         double dInput = (error - lastError) / timeChange;
       /*Compute PID Output*/
-      double output = kp * error + ITerm + kd * dInput;
+      double output = feed + kp * error + ITerm + kd * dInput;
       
 	  if(output > outMax) output = outMax;
       else if(output < outMin) output = outMin;
@@ -100,6 +102,22 @@ void PID::SetTunings(double Kp, double Ki, double Kd)
    }
 }
   
+/* SetTuningsBumpless(...)*****************************************************
+ * the integral takes up the change of the proportional term at the current
+ * error, so the next output continues from the last one
+ ******************************************************************************/
+void PID::SetTuningsBumpless(double Kp, double Ki, double Kd)
+{
+   double oldKp = kp;
+   PID::SetTunings(Kp, Ki, Kd);
+   if(!inAuto) return;
+
+   double feed = myFeedForward ? *myFeedForward : 0;
+   ITerm += (oldKp - kp) * (*mySetpoint - *myInput);
+   if(ITerm > outMax - feed) ITerm= outMax - feed;
+   else if(ITerm < outMin - feed) ITerm= outMin - feed;
+}
+
 /* SetSampleTime(...) *********************************************************
  * sets the period, in Milliseconds, at which the calculation is performed	
  ******************************************************************************/
@@ -115,6 +133,15 @@ void PID::SetSampleTime(int NewSampleTime)
    }
 }
  
+/* SetFeedForward(...) ********************************************************
+ * the term is read at every Compute() and added to the output; the
+ * integral is clamped so that feed-forward + ITerm stays in the limits
+ ******************************************************************************/
+void PID::SetFeedForward(double* FeedForward)
+{
+   myFeedForward = FeedForward;
+}
+
 /* SetOutputLimits(...)****************************************************
  *     This function will be used far more often than SetInputLimits.  while
  *  the input to the controller will generally be in the 0-1023 range (which is
@@ -160,10 +187,11 @@ void PID::SetMode(int Mode)
  ******************************************************************************/ 
 void PID::Initialize()
 {
-   ITerm = *myOutput;
+   double feed = myFeedForward ? *myFeedForward : 0;
+   ITerm = *myOutput - feed;
    lastInput = *myInput;
-   if(ITerm > outMax) ITerm = outMax;
-   else if(ITerm < outMin) ITerm = outMin;
+   if(ITerm > outMax - feed) ITerm = outMax - feed;
+   else if(ITerm < outMin - feed) ITerm = outMin - feed;
 }
 
 /* SetControllerDirection(...)*************************************************
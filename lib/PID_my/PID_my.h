@@ -39,8 +39,13 @@ class PID
 										  //   means the output will increase when error is positive. REVERSE
 										  //   means the opposite.  it's very unlikely that this will be needed
 										  //   once it is set in the constructor.
+    void SetTuningsBumpless(double,       // * SetTunings while running without a step in
+                    double, double);      //   the output, e.g. from a gain schedule
     void SetSampleTime(int);              // * sets the frequency, in Milliseconds, with which 
                                           //   the PID calculation is performed.  default is 100
+    void SetFeedForward(double*);         // * links a term added to the output as it is, e.g. the
+                                          //   power a setpoint ramp needs; the integral only
+                                          //   makes up the rest. NULL (default) - none
 										  
 										  
 										  
@@ -68,6 +73,7 @@ class PID
     double *myOutput;             //   This creates a hard link between the variables and the 
     double *mySetpoint;           //   PID, freeing the user from having to constantly tell us
                                   //   what these values are.  with pointers we'll just know.
+    double *myFeedForward;
 			  
 	unsigned long lastTime;
 	double ITerm, lastInput, lastError;
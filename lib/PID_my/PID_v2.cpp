@@ -0,0 +1,192 @@
+#if ARDUINO >= 100
+  #include "Arduino.h"
+#else
+  #include "WProgram.h"
+#endif
+
+#include <math.h>
+#include <PID_v2.h>
+
+/*Constructor (...)*********************************************************
+ *    limits 0-255 like PID, 100 ms minimum interval, 1 s derivative filter
+ ***************************************************************************/
+PIDv2::PIDv2(double* Input, double* Output, double* Setpoint,
+        double Kp, double Ki, double Kd, int ControllerDirection)
+{
+	myOutput = Output;
+	myInput = Input;
+	mySetpoint = Setpoint;
+	myFeedForward = NULL;
+	inAuto = false;
+	ITerm = 0;
+	DTerm = 0;
+	lastInput = 0;
+	filterTime = 1.0;
+
+	SetOutputLimits(0, 255);
+	SampleTime = 100;
+
+	controllerDirection = DIRECT;
+	SetControllerDirection(ControllerDirection);
+	SetTunings(Kp, Ki, Kd);
+
+	lastTime = millis();
+}
+
+/* Compute() **********************************************************************
+ *     dt is the time since the last computation. the output uses the integral
+ *   as it stood; then the integral takes ki*error*dt plus the part of the
+ *   output the limits cut off, times dt/Tt.
+ **********************************************************************************/
+bool PIDv2::Compute()
+{
+	if(!inAuto) return false;
+	unsigned long now = millis();
+	unsigned long timeChange = (now - lastTime);
+	if(timeChange < SampleTime) return false;
+
+	double dt = (double)timeChange / 1000;
+	double input = *myInput;
+	double error = *mySetpoint - input;
+	double feed = myFeedForward ? *myFeedForward : 0;
+
+	/*derivative on measurement, first-order low pass*/
+	DTerm = (filterTime * DTerm - kd * (input - lastInput)) / (filterTime + dt);
+
+	double output = feed + kp * error + ITerm + DTerm;
+	double limited = output;
+	if(limited > outMax) limited = outMax;
+	else if(limited < outMin) limited = outMin;
+	*myOutput = limited;
+
+	/*integral with back-calculation; the clamp only guards a huge ki*dt*/
+	double track = kt * dt;
+	if(track > 1) track = 1;
+	ITerm += ki * error * dt + (limited - output) * track;
+	if(ITerm > outMax - feed) ITerm = outMax - feed;
+	else if(ITerm < outMin - feed) ITerm = outMin - feed;
+
+	lastInput = input;
+	lastTime = now;
+	return true;
+}
+
+/* SetTunings(...)*************************************************************
+ * Kp, Ki per second, Kd in seconds. the tracking time is sqrt(Ti*Td) =
+ * sqrt(Kd/Ki), or Ti = Kp/Ki without D
+ ******************************************************************************/
+void PIDv2::SetTunings(double Kp, double Ki, double Kd)
+{
+	if (Kp<0 || Ki<0 || Kd<0) return;
+
+	dispKp = Kp; dispKi = Ki; dispKd = Kd;
+
+	kp = Kp;
+	ki = Ki;
+	kd = Kd;
+	if(Ki <= 0) kt = 0;
+	else if(Kd > 0) kt = sqrt(Ki / Kd);
+	else if(Kp > 0) kt = Ki / Kp;
+	else kt = 1000;	// pure I: drop what was cut off at once
+
+	if(controllerDirection ==REVERSE)
+	{
+		kp = (0 - kp);
+		ki = (0 - ki);
+		kd = (0 - kd);
+	}
+}
+
+/* SetTuningsBumpless(...)*****************************************************
+ * see PID; the filtered derivative is kept as it is
+ ******************************************************************************/
+void PIDv2::SetTuningsBumpless(double Kp, double Ki, double Kd)
+{
+	double oldKp = kp;
+	SetTunings(Kp, Ki, Kd);
+	if(!inAuto) return;
+
+	double feed = myFeedForward ? *myFeedForward : 0;
+	ITerm += (oldKp - kp) * (*mySetpoint - *myInput);
+	if(ITerm > outMax - feed) ITerm = outMax - feed;
+	else if(ITerm < outMin - feed) ITerm = outMin - feed;
+}
+
+/* SetSampleTime(...) *********************************************************
+ * minimum interval between computations, ms; the gains do not depend on it
+ ******************************************************************************/
+void PIDv2::SetSampleTime(int NewSampleTime)
+{
+	if (NewSampleTime > 0)
+		SampleTime = (unsigned long)NewSampleTime;
+}
+
+/* SetDerivativeFilter(...) ***************************************************
+ * time constant of the low pass on the derivative, s; 0 - unfiltered
+ ******************************************************************************/
+void PIDv2::SetDerivativeFilter(double Seconds)
+{
+	if (Seconds >= 0)
+		filterTime = Seconds;
+}
+
+/* SetOutputLimits(...)****************************************************
+ * same as PID
+ **************************************************************************/
+void PIDv2::SetOutputLimits(double Min, double Max)
+{
+	if(Min >= Max) return;
+	outMin = Min;
+	outMax = Max;
+
+	if(inAuto)
+	{
+		if(*myOutput > outMax) *myOutput = outMax;
+		else if(*myOutput < outMin) *myOutput = outMin;
+
+		if(ITerm > outMax) ITerm= outMax;
+		else if(ITerm < outMin) ITerm= outMin;
+	}
+}
+
+/* SetMode(...)****************************************************************
+ * Allows the controller Mode to be set to manual (0) or Automatic (non-zero)
+ ******************************************************************************/
+void PIDv2::SetMode(int Mode)
+{
+	bool newAuto = (Mode == AUTOMATIC);
+	if(newAuto == !inAuto)
+	{  /*we just went from manual to auto*/
+		Initialize();
+	}
+	inAuto = newAuto;
+}
+
+/* Initialize()****************************************************************
+ *	bumpless transfer; the clock restarts too, so the first dt is not the
+ *  time spent in manual
+ ******************************************************************************/
+void PIDv2::Initialize()
+{
+	double feed = myFeedForward ? *myFeedForward : 0;
+	ITerm = *myOutput - feed;
+	if(ITerm > outMax - feed) ITerm = outMax - feed;
+	else if(ITerm < outMin - feed) ITerm = outMin - feed;
+	DTerm = 0;
+	lastInput = *myInput;
+	lastTime = millis();
+}
+
+/* SetControllerDirection(...)*************************************************
+ * same as PID
+ ******************************************************************************/
+void PIDv2::SetControllerDirection(int Direction)
+{
+	if(inAuto && Direction !=controllerDirection)
+	{
+		kp = (0 - kp);
+		ki = (0 - ki);
+		kd = (0 - kd);
+	}
+	controllerDirection = Direction;
+}
@@ -0,0 +1,71 @@
+#ifndef PID_v2_h
+#define PID_v2_h
+
+#include <PID_my.h>
+
+/*
+	PIDv2 - PID with the same API, selected at compile time (-DPID_V2).
+
+	Differences from PID::Compute():
+	- the elapsed time is measured at every call and used as dt, so the
+	  gains are in plain units (Ki per second, Kd in seconds) whatever the
+	  cadence. SampleTime is only the minimum interval, 100 ms by default;
+	  the caller paces the calls.
+	- the derivative is taken on the measurement through a first-order
+	  filter (SetDerivativeFilter, 1 s by default), so setpoint steps and
+	  ramp corners do not kick the output.
+	- back-calculation anti-windup: whatever the output limits cut off is
+	  fed back into the integral with the tracking time Tt = sqrt(Ti*Td)
+	  (Ti without D), so the integral stops growing while saturated and
+	  comes back off a limit without the overshoot of a full ITerm.
+
+	Gains entered for PID are not the same controller here: its D is 250
+	times weaker (kd scaled by the sample time and divided by the ms again)
+	and its I runs at 250 ms per call while it is called every ~400 ms.
+*/
+
+class PIDv2
+{
+  public:
+	PIDv2(double*, double*, double*,	// * same parameters as PID
+	      double, double, double, int);
+
+	void SetMode(int Mode);
+	bool Compute();
+	void SetOutputLimits(double, double);
+	void SetTunings(double, double, double);
+	void SetTuningsBumpless(double, double, double);
+	void SetControllerDirection(int);
+	void SetSampleTime(int);
+	void SetFeedForward(double* FeedForward) { myFeedForward = FeedForward; }
+	void SetDerivativeFilter(double);	// * time constant of the derivative filter, s
+
+	double GetKp() { return dispKp; }
+	double GetKi() { return dispKi; }
+	double GetKd() { return dispKd; }
+	int GetMode() { return inAuto ? AUTOMATIC : MANUAL; }
+	int GetDirection() { return controllerDirection; }
+
+  private:
+	void Initialize();
+
+	double dispKp, dispKi, dispKd;
+	double kp, ki, kd;	// signed by the direction
+	double kt;			// 1/Tt, back-calculation gain
+	double filterTime;
+
+	int controllerDirection;
+
+	double *myInput;
+	double *myOutput;
+	double *mySetpoint;
+	double *myFeedForward;
+
+	unsigned long lastTime;
+	double ITerm, DTerm, lastInput;
+
+	unsigned long SampleTime;
+	double outMin, outMax;
+	bool inAuto;
+};
+#endif
@@ -0,0 +1,118 @@
+#include "autotune.h"
+
+static byte state = AUTOTUNE_OFF;
+static double set, high;
+static unsigned long start;
+static bool relayOn;
+static byte cycles;             //finished cycles, the first one is not counted
+static unsigned long cycleStart;//ms, last off -> on switch
+static unsigned long onSince;   //ms, heater on
+static double onFrom;           //C when it went on
+static double peak, trough;     //of the half cycle in progress
+static double sumMax, sumMin, sumPeriod;
+static AutotuneResult result;
+
+/**
+ * @brief starts the experiment, output 0..outMax
+ */
+void autotuneStart(double setpoint, double outMax, unsigned long now)
+{
+  set = setpoint;
+  high = outMax;
+  start = now;
+  relayOn = true;
+  onSince = now;
+  onFrom = 1000; //first read
+  cycles = 0;
+  cycleStart = 0;
+  peak = -1000;
+  trough = 1000;
+  sumMax = sumMin = sumPeriod = 0;
+  memset(&result, 0, sizeof(result));
+  state = AUTOTUNE_RUNNING;
+}
+
+static byte finish()
+{
+  double a = (sumMax - sumMin) / AUTOTUNE_CYCLES / 2;
+  if (a <= AUTOTUNE_BAND)
+    return state = AUTOTUNE_FAILED;
+
+  result.amplitude = a;
+  result.pu = sumPeriod / AUTOTUNE_CYCLES / 1000;
+  result.ku = 4 * (high / 2) / (M_PI * sqrt(a*a - AUTOTUNE_BAND*AUTOTUNE_BAND));
+  result.kp = result.ku / 2.2;
+  result.ki = result.kp / (result.pu * 2.2);
+  result.kd = result.kp * result.pu / 6.3;
+  return state = AUTOTUNE_DONE;
+}
+
+/**
+ * @brief one step at the PID rate: sets output, returns the state
+ */
+byte autotuneStep(double input, unsigned long now, double &output)
+{
+  if (state != AUTOTUNE_RUNNING)
+    return state;
+
+  if (relayOn && input < onFrom)
+    onFrom = input;
+  if (now - start > AUTOTUNE_TIMEOUT * 1000UL || input > set + AUTOTUNE_LIMIT ||
+      (relayOn && now - onSince > AUTOTUNE_STALL * 1000UL && input < onFrom + 2))
+  {
+    output = 0;
+    return state = AUTOTUNE_FAILED;
+  }
+
+  //the extremes come after the switches, the lag keeps the plate going
+  if (input > peak) peak = input;
+  if (input < trough) trough = input;
+
+  if (relayOn && input > set + AUTOTUNE_BAND)
+  {
+    relayOn = false;
+    if (cycleStart != 0 && cycles > 0)
+      sumMin += trough;
+    peak = input;
+  }
+  else if (!relayOn && input < set - AUTOTUNE_BAND)
+  {
+    relayOn = true;
+    onSince = now;
+    onFrom = input;
+    if (cycleStart != 0)
+    {
+      if (cycles > 0)
+      {
+        sumMax += peak;
+        sumPeriod += now - cycleStart;
+      }
+      cycles++;
+    }
+    cycleStart = now;
+    trough = input;
+    if (cycles > AUTOTUNE_CYCLES)
+    {
+      output = 0;
+      return finish();
+    }
+  }
+
+  output = relayOn ? high : 0;
+  return state;
+}
+
+void autotuneStop()
+{
+  state = AUTOTUNE_OFF;
+}
+
+byte autotuneState()
+{
+  return state;
+}
+
+const AutotuneResult &autotuneResult()
+{
+  return result;
+}
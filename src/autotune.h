@@ -0,0 +1,49 @@
+#ifndef IHC_AUTOTUNE_h
+#define IHC_AUTOTUNE_h
+
+#include <Arduino.h>
+
+/*
+	Relay autotuner (Astrom-Hagglund). The heater is switched fully on
+	below setpoint - AUTOTUNE_BAND and off above setpoint + AUTOTUNE_BAND;
+	the plate settles into a limit cycle whose amplitude a and period Pu
+	give the ultimate gain of the loop
+	  Ku = 4 d / (pi sqrt(a^2 - band^2)),  d = half the output swing
+	The first cycle (the heat-up) is skipped, the next AUTOTUNE_CYCLES are
+	averaged. Tunings are Tyreus-Luyben, slower than Ziegler-Nichols and
+	with less overshoot:
+	  Kp = Ku / 2.2,  Ti = 2.2 Pu,  Td = Pu / 6.3
+	as Kp, Ki = Kp / Ti, Kd = Kp Td in continuous time: output per C, per
+	C*s, per C/s. Only PIDv2 takes them like that; tuneGains() in main.cpp
+	converts them for the controller compiled in.
+
+	The run fails after AUTOTUNE_TIMEOUT, when the plate gets AUTOTUNE_LIMIT
+	above the setpoint, or when it has not risen 2 C in AUTOTUNE_STALL with
+	the heater on: this stands in for the thermocouple test of a profile
+	run, which needs a setpoint that starts at the plate temperature.
+*/
+
+#define AUTOTUNE_SET     150  //C, middle of the soak
+#define AUTOTUNE_BAND    0.5  //C, relay hysteresis, above the filtered sensor noise
+#define AUTOTUNE_CYCLES  3
+#define AUTOTUNE_TIMEOUT 1200 //s
+#define AUTOTUNE_LIMIT   40   //C over the setpoint
+#define AUTOTUNE_STALL   60   //s with the heater on and no rise
+
+enum { AUTOTUNE_OFF, AUTOTUNE_RUNNING, AUTOTUNE_DONE, AUTOTUNE_FAILED };
+
+typedef struct AutotuneResultStruct {
+    double ku;          //output per C
+    double pu;          //s
+    double amplitude;   //C, half the peak to peak
+    double kp, ki, kd;
+} AutotuneResult;
+
+void autotuneStart(double setpoint, double outMax, unsigned long now);
+byte autotuneStep(double input, unsigned long now, double &output);
+void autotuneStop();
+byte autotuneState();
+
+const AutotuneResult &autotuneResult();
+
+#endif
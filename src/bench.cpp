@@ -0,0 +1,178 @@
+/*
+	On-target benchmarks, built only with -DPID_BENCH. Results go to Serial
+	once from setup(); the host side of the comparison is
+	`program --bench pid` on the native target.
+*/
+
+#if defined(PID_BENCH) && defined(__AVR__)
+
+#include <Arduino.h>
+#include <PID_my.h>
+#include <PID_fixed.h>
+#include <PID_v2.h>
+#include "bench.h"
+#include "mpc.h"
+
+/**
+ * @brief CPU cycles of one Compute() that actually computes, averaged
+ *
+ * Timer1 runs at F_CPU (wraps at 4 ms); each sample starts right after a
+ * millis() tick so Timer0 does not interrupt it.
+ */
+template <class T> static uint32_t computeCycles(T &pid, double &input)
+{
+	const byte N = 64;
+	uint32_t sum = 0;
+	byte done = 0;
+
+	pid.SetSampleTime(1);
+	while (done < N)
+	{
+		unsigned long t = millis();
+		while (millis() == t);
+
+		input = 150 + (done & 7) * 1.75;
+		TCNT1 = 0;
+		bool computed = pid.Compute();
+		uint16_t cycles = TCNT1;
+		if (computed)
+		{
+			sum += cycles;
+			done++;
+		}
+	}
+	return sum / N;
+}
+
+void benchPID()
+{
+	double input = 150, setpoint = 160, out_d = 0, out_f = 0, out_2 = 0;
+	PID pid_d(&input, &out_d, &setpoint, 50, 0.1, 20, DIRECT);
+	PIDFixed<16> pid_f(&input, &out_f, &setpoint, 50, 0.1, 20, DIRECT);
+	PIDv2 pid_2(&input, &out_2, &setpoint, 50, 0.1, 20, DIRECT);
+	pid_d.SetOutputLimits(0, 500);
+	pid_f.SetOutputLimits(0, 500);
+	pid_2.SetOutputLimits(0, 500);
+	pid_d.SetMode(AUTOMATIC);
+	pid_f.SetMode(AUTOMATIC);
+	pid_2.SetMode(AUTOMATIC);
+
+	byte tccr1a = TCCR1A, tccr1b = TCCR1B;
+	TCCR1A = 0;
+	TCCR1B = _BV(CS10);	// clk/1
+
+	uint32_t c_d = computeCycles(pid_d, input);
+	uint32_t c_f = computeCycles(pid_f, input);
+	uint32_t c_2 = computeCycles(pid_2, input);
+
+	TCCR1A = tccr1a;
+	TCCR1B = tccr1b;
+
+	Serial.print(F("PID::Compute cycles: "));
+	Serial.print(c_d);
+	Serial.print(F(" ("));
+	Serial.print(c_d / (F_CPU / 1000000UL));
+	Serial.print(F(" us)\n"));
+	Serial.print(F("PIDFixed<16>::Compute cycles: "));
+	Serial.print(c_f);
+	Serial.print(F(" ("));
+	Serial.print(c_f / (F_CPU / 1000000UL));
+	Serial.print(F(" us)\n"));
+	Serial.print(F("PIDv2::Compute cycles: "));
+	Serial.print(c_2);
+	Serial.print(F(" ("));
+	Serial.print(c_2 / (F_CPU / 1000000UL));
+	Serial.print(F(" us)\n"));
+}
+
+/**
+ * @brief CPU cycles of mpcStep() over the default profile, mean and max
+ */
+void benchMPC()
+{
+	ProfileS profile;
+	ProfileTable table;
+	profileDefault(profile);
+	profileCompile(table, profile, 25);
+	PlantModel model = {OBSERVER_RISE, OBSERVER_TAU, OBSERVER_LAG};
+
+	byte tccr1a = TCCR1A, tccr1b = TCCR1B;
+	TCCR1A = 0;
+	TCCR1B = _BV(CS10);	// clk/1
+
+	uint32_t sum = 0;
+	uint16_t max = 0, steps = 0;
+	unsigned long now = millis();
+	long set;
+	byte phase;
+	mpcStart(model, 25, now);
+	for (unsigned int t = 0; profileSetpoint(table, t, set, phase); t += 3)
+	{
+		double duty;
+		now += MPC_PERIOD;
+		noInterrupts();
+		TCNT1 = 0;
+		mpcStep((double)set / (1L << PROFILE_Q) - 2, table, t, now, duty);
+		uint16_t cycles = TCNT1;
+		interrupts();
+		sum += cycles;
+		if (cycles > max) max = cycles;
+		steps++;
+	}
+
+	TCCR1A = tccr1a;
+	TCCR1B = tccr1b;
+
+	Serial.print(F("mpcStep cycles: "));
+	Serial.print(sum / steps);
+	Serial.print(F(" mean, "));
+	Serial.print(max);
+	Serial.print(F(" max\n"));
+}
+
+/*
+	RAM budget. The linker symbols bound .data + .bss; the heap starts at
+	__heap_start and grows to __brkval, the stack grows down from RAMEND.
+	benchPaint() marks the gap between them, benchRAM() finds the lowest
+	byte the stack has overwritten since: the deepest it went in the benches
+	and setup() so far.
+*/
+
+extern char __data_start, __bss_end, __heap_start;
+extern char *__brkval;
+
+#define BENCH_MARK 0xA5
+
+static char *heapEnd()
+{
+	return __brkval ? __brkval : &__heap_start;
+}
+
+void benchPaint()
+{
+	char here;
+	for (char *p = heapEnd(); p < &here - 16; p++)	// leave this frame alone
+		*p = BENCH_MARK;
+}
+
+void benchRAM()
+{
+	char here;
+	char *p = heapEnd();
+	while (p < &here && *p == (char)BENCH_MARK)
+		p++;
+
+	Serial.print(F(".data + .bss: "));
+	Serial.print((unsigned int)(&__bss_end - &__data_start));
+	Serial.print(F(" bytes, heap "));
+	Serial.print((unsigned int)(heapEnd() - &__heap_start));
+	Serial.print(F(", free now "));
+	Serial.print((unsigned int)(&here - heapEnd()));
+	Serial.print(F(", stack peak "));
+	Serial.print((unsigned int)((char *)RAMEND - p + 1));
+	Serial.print(F(" of "));
+	Serial.print((unsigned int)((char *)RAMEND + 1 - &__data_start));
+	Serial.print("\n");
+}
+
+#endif
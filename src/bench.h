@@ -0,0 +1,11 @@
+#ifndef IHC_BENCH_h
+#define IHC_BENCH_h
+
+#if defined(PID_BENCH) && defined(__AVR__)
+void benchPID();	// cycle count of PID vs PIDFixed and PIDv2, printed to Serial
+void benchMPC();	// cycle count of mpcStep(), printed to Serial
+void benchPaint();	// fills the free RAM between heap and stack with a mark
+void benchRAM();	// .data + .bss, free RAM and the deepest stack since benchPaint()
+#endif
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef IHC_CRC_h
+#define IHC_CRC_h
+
+#include <stdint.h>
+
+/*
+	CRC-16/CCITT-FALSE (poly 0x1021, start with 0xFFFF), bitwise: no table
+	in flash. Used by the telemetry frames and the EEPROM store; also built
+	into the host tools, so nothing Arduino here.
+*/
+
+#define CRC16_INIT 0xFFFF
+
+static inline uint16_t crc16(uint16_t crc, uint8_t data)
+{
+	crc ^= (uint16_t)data << 8;
+	for (uint8_t i = 0; i < 8; i++)
+		crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	return crc;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "format.h"
+
+/**
+ * @brief fixed point: value is scaled by 10^decimals, 
+ * fmtFixed(buf, 6, 150, 2, "C") gives "1.50C"
+ */
+byte fmtFixed(char *buf, byte size, long value, byte decimals, const char *suffix)
+{
+  if (size == 0)
+    return 0;
+
+  char digits[12]; //least significant first
+  byte len = 0;
+  unsigned long v = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+  if (decimals > 9)
+    decimals = 9;
+  do {
+    digits[len++] = '0' + v % 10;
+    v /= 10;
+  } while (v != 0 || len <= decimals); //at least one digit before the point
+
+  byte n = 0;
+  if (value < 0 && n + 1 < size)
+    buf[n++] = '-';
+  while (len != 0 && n + 1 < size)
+  {
+    if (decimals != 0 && len == decimals)
+    {
+      buf[n++] = '.';
+      if (n + 1 >= size)
+        break;
+    }
+    buf[n++] = digits[--len];
+  }
+  while (*suffix != 0 && n + 1 < size)
+    buf[n++] = *suffix++;
+  buf[n] = 0;
+  return n;
+}
+
+byte fmtInt(char *buf, byte size, long value, const char *suffix)
+{
+  return fmtFixed(buf, size, value, 0, suffix);
+}
+
+/**
+ * @brief whole degrees, "231C"
+ */
+byte fmtTemper(char *buf, byte size, double value)
+{
+  return fmtInt(buf, size, round(value), "C");
+}
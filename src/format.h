@@ -0,0 +1,17 @@
+#ifndef IHC_FORMAT_h
+#define IHC_FORMAT_h
+
+#include <Arduino.h>
+
+/*
+	Heap-free text fields for the display: every function writes into a
+	caller buffer of `size` bytes, always terminates it and cuts the text
+	like String::toCharArray() would. The return value is the number of
+	characters written, so fields can be chained into one buffer.
+*/
+
+byte fmtFixed(char *buf, byte size, long value, byte decimals, const char *suffix = "");
+byte fmtInt(char *buf, byte size, long value, const char *suffix = "");
+byte fmtTemper(char *buf, byte size, double value);
+
+#endif
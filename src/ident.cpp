@@ -0,0 +1,151 @@
+#include "ident.h"
+
+#define IDENT_READ  1000 //ms between reads taken into the fit
+#define IDENT_READS 20   //fewest reads for a fit
+
+static byte state = IDENT_OFF;
+static double amb, high;
+static unsigned long start, last;
+static bool stepping;
+static double T0, I;            //C; C*s
+static unsigned int settleReads;
+static double s[3][3], sy[3];   //normal equations, scaled: t/100 s, I/10000 C*s, (T - T0)/100 C
+static unsigned int reads;
+static PlantModel result;
+
+/**
+ * @brief starts the experiment with the heater off, output 0..outMax
+ */
+void identStart(double ambient, double outMax, unsigned long now)
+{
+  amb = ambient;
+  high = outMax;
+  start = now;
+  last = now - IDENT_READ;
+  stepping = false;
+  T0 = I = 0;
+  settleReads = reads = 0;
+  memset(s, 0, sizeof(s));
+  memset(sy, 0, sizeof(sy));
+  memset(&result, 0, sizeof(result));
+  state = IDENT_RUNNING;
+}
+
+static double det3(double m[3][3])
+{
+  return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+       - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+       + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+static byte finish()
+{
+  if (reads < IDENT_READS)
+    return state = IDENT_FAILED;
+
+  //Cramer's rule, the sums are of the order of one
+  double d = det3(s);
+  if (fabs(d) < 1e-12)
+    return state = IDENT_FAILED;
+  double x[3];
+  for (byte k = 0; k < 3; k++)
+  {
+    double m[3][3];
+    memcpy(m, s, sizeof(m));
+    for (byte r = 0; r < 3; r++)
+      m[r][k] = sy[r];
+    x[k] = det3(m) / d;
+  }
+
+  double a = x[0];          //C/s
+  double b = x[1] / 100;    //1/s
+  double c = x[2] * 100;    //C
+  double slope = a + b * (T0 - amb);
+  if (a <= 0 || b >= 0 || slope <= 0)
+    return state = IDENT_FAILED;
+
+  result.rise = a / IDENT_DUTY;
+  result.tau = -1 / b;
+  result.lag = -c / slope;
+  if (result.tau < 10 || result.tau > 5000 || result.lag < 0 || result.lag > 60)
+    return state = IDENT_FAILED;
+  return state = IDENT_DONE;
+}
+
+/**
+ * @brief one step at the PID rate: sets output, returns the state
+ *
+ * @param input - T_Bottom, the sensor itself: the lag is part of the fit
+ */
+byte identStep(double input, unsigned long now, double &output)
+{
+  if (state != IDENT_RUNNING)
+    return state;
+  output = stepping ? high * IDENT_DUTY : 0;
+  if (now - last < IDENT_READ)
+    return state;
+  double dt = (now - last) / 1000.0;
+  last = now;
+
+  if (!stepping)
+  {
+    if (input > amb + IDENT_WARM)
+    {
+      output = 0;
+      return state = IDENT_FAILED;
+    }
+    T0 += input;
+    settleReads++;
+    if (now - start >= IDENT_SETTLE * 1000UL)
+    {
+      T0 /= settleReads;
+      stepping = true;
+      start = now;
+      output = high * IDENT_DUTY;
+    }
+    return state;
+  }
+
+  I += (input - amb) * dt;
+  double t = (now - start) / 1000.0;
+  if (t > IDENT_STALL && input < T0 + 2)
+  {
+    output = 0;
+    return state = IDENT_FAILED;
+  }
+
+  if (t >= IDENT_SKIP)
+  {
+    double v[3] = {t / 100, I / 10000, 1};
+    double y = (input - T0) / 100;
+    for (byte r = 0; r < 3; r++)
+    {
+      for (byte k = 0; k < 3; k++)
+        s[r][k] += v[r] * v[k];
+      sy[r] += v[r] * y;
+    }
+    reads++;
+  }
+
+  if (t >= IDENT_TIME || input >= T0 + IDENT_RISE)
+  {
+    output = 0;
+    return finish();
+  }
+  return state;
+}
+
+void identStop()
+{
+  state = IDENT_OFF;
+}
+
+byte identState()
+{
+  return state;
+}
+
+const PlantModel &identResult()
+{
+  return result;
+}
@@ -0,0 +1,41 @@
+#ifndef IHC_IDENT_h
+#define IHC_IDENT_h
+
+#include <Arduino.h>
+#include "observer.h"
+
+/*
+	Step response identification of the plate, first order plus dead time
+	in the terms of observer.h:
+	  dT/dt = rise * duty - (T - ambient) / tau,  T_Bottom = T delayed by lag
+	The heater stays off IDENT_SETTLE for the start level T0, then runs at
+	IDENT_DUTY of the window until the plate is IDENT_RISE over T0 or
+	IDENT_TIME has passed. Integrated, the model is linear in the unknowns:
+	  T_Bottom(t) - T0 = a t + b I(t) + c,  I(t) = integral of (T_Bottom - ambient)
+	  a = rise * duty,  b = -1 / tau,  c = -lag (a + b (T0 - ambient))
+	so a least squares fit over the reads from IDENT_SKIP on (the lag has
+	passed) needs nine running sums and no sample buffer. The lag comes out
+	as the mean delay plate to T_Bottom: transport delay plus probe lag.
+
+	The run fails when the plate starts more than IDENT_WARM over ambient,
+	has not risen 2 C IDENT_STALL into the step, or the fit is out of range.
+*/
+
+#define IDENT_DUTY   0.5  //share of the heater window during the step
+#define IDENT_SETTLE 20   //s heater off before the step
+#define IDENT_SKIP   30   //s into the step before the fit takes reads
+#define IDENT_TIME   300  //s, longest step
+#define IDENT_RISE   100  //C over T0, the step ends
+#define IDENT_STALL  60   //s
+#define IDENT_WARM   10   //C over ambient at the start
+
+enum { IDENT_OFF, IDENT_RUNNING, IDENT_DONE, IDENT_FAILED };
+
+void identStart(double ambient, double outMax, unsigned long now);
+byte identStep(double input, unsigned long now, double &output);
+void identStop();
+byte identState();
+
+const PlantModel &identResult();
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef IHC_h
+#define IHC_h
+
+#include <Arduino.h>
+#include "scheduler.h"
+#include "observer.h"
+
+#define PROFILE_POINTS 10 //control points per profile
+#define PROFILE_TIME_MAX 999
+#define PROFILE_TEMPER_MAX 400
+
+//one control point, 3 bytes in EEPROM
+#pragma pack(push,1)
+typedef struct ProfilePointStruct {
+    unsigned long time: 10;   //s from the previous point
+    unsigned long temper: 9;  //C reached at the end of the point
+    unsigned long step: 1;    //0 - ramp from the previous point, 1 - jump to temper and hold
+} ProfilePoint;
+#pragma pack(pop)
+
+typedef struct ProfileStruct {
+    byte count; //points in use, 1..PROFILE_POINTS
+    ProfilePoint point[PROFILE_POINTS];
+} ProfileS;
+
+#define GAIN_BANDS 3 //gain sets besides EEprom.P/I/D
+
+//PID gains while T_Set is at or above `from`
+typedef struct GainBandStruct {
+    unsigned int from; //C, 0 - not used
+    unsigned int P;
+    double I;
+    unsigned int D;
+} GainBand;
+
+struct EEpromStruct {
+    unsigned int Pulse;
+    unsigned int P;
+    double I;
+    unsigned int D;
+    double thermocorrection;
+    byte T_Ambient;
+    byte ErrorRate;
+    byte Mode;// 3-manual 2,1,0-prof
+    int T_manual;
+    unsigned int Time_entry_manual;
+    unsigned int Time_hold_manual;
+    ProfileS TProfile[3];
+    GainBand Gain[GAIN_BANDS]; //CONFIG_VERSION 2
+    byte Control; //bit n set: profile n runs mpc.h instead of the PID, CONFIG_VERSION 3; bit CONTROL_ILC+n: the PID takes the ilc.h correction
+    PlantModel Model; //plate model of the observer, feed-forward and mpc.h: ident.h or OBSERVER_*, CONFIG_VERSION 4
+};
+
+#define CONTROL_ILC 4 //EEprom.Control: first ilc.h bit, the bits below are mpc.h's
+
+/////////////////////////////////////////////////////////////////////////////////state shared with the native runner
+extern struct EEpromStruct EEprom;
+extern double T_Bottom;
+extern bool ObserverInput;
+extern bool FeedForward;
+extern double T_Set;
+extern double OutBottom;
+extern bool on_off;
+extern byte ProfilStatus;
+
+enum { TASK_OUTPUT, TASK_PID, TASK_SENSOR, TASK_PROFILE, TASK_TELEMETRY, TASK_DISPLAY, TASK_PAGE, TASK_ENCODER, TASK_SERIAL, TASKS };
+extern Task Tasks[TASKS]; //loop() task table, in main.cpp below the task functions
+
+typedef struct DisplayStatsStruct {
+    unsigned long frames;    //frames sent
+    unsigned long skipped;   //frames not sent, nothing changed
+    unsigned long frameLast; //us from firstPage() to the last page
+    unsigned long frameMax;  //us
+    unsigned long pageMax;   //us, longest single page, i.e. longest loop() block
+} DisplayStats;
+extern DisplayStats DisplayStat;
+
+void RunHot(byte MODE);
+void StopHot();
+void compileProfile();
+void displayRestart();
+
+#endif
@@ -0,0 +1,145 @@
+#include "ilc.h"
+
+#define U_Q    7  //u[], 1/128 duty
+#define NEXT_Q 14 //next[], 1/16384 duty
+#define NONE   0xFF
+
+typedef struct IlcTableStruct {
+  int8_t u[ILC_BINS];
+  unsigned int bin;   //s a bin, 0 - empty
+  IlcStats stats;
+} IlcTable;
+
+static IlcTable table[3];
+static int next[ILC_BINS];      //u of the next run, learned during this one
+static byte active = NONE;      //profile of the run
+static unsigned int bin;        //s
+static byte used;               //bins the profile reaches
+static unsigned int lead;       //s
+static double sumSq;            //error^2 of this run
+static unsigned int samples;
+
+void ilcReset(byte profile)
+{
+  if (profile < 3)
+    memset(&table[profile], 0, sizeof(IlcTable));
+}
+
+/**
+ * @brief start of a run of the profile, the table of another length is cleared
+ *
+ * @param lag - s, plate model: the duty shows in the error this much later
+ */
+void ilcStart(byte profile, const ProfileS &points, double lag)
+{
+  unsigned int total = 0;
+  for (byte i = 0; i < points.count; i++)
+    total += points.point[i].time;
+  bin = (total + ILC_BINS - 1) / ILC_BINS;
+  if (bin == 0)
+    bin = 1;
+  used = total ? (total + bin - 1) / bin : 1;
+  if (table[profile].bin != bin)
+  {
+    ilcReset(profile);
+    table[profile].bin = bin;
+  }
+
+  for (byte j = 0; j < ILC_BINS; j++)
+    next[j] = table[profile].u[j] << (NEXT_Q - U_Q);
+  lead = lag > 0 ? round(lag) : 0;
+  sumSq = 0;
+  samples = 0;
+  active = profile;
+}
+
+/**
+ * @brief learned duty at the time of the run, between the bin centres
+ */
+double ilcCorrection(unsigned int time)
+{
+  if (active == NONE)
+    return 0;
+  const int8_t *u = table[active].u;
+  double f = (double)time / bin - 0.5;
+  if (f <= 0)
+    return (double)u[0] / (1 << U_Q);
+  byte j = f;
+  if (j >= used - 1)
+    return (double)u[used - 1] / (1 << U_Q);
+  double w = f - j;
+  return (u[j] * (1 - w) + u[j + 1] * w) / (1 << U_Q);
+}
+
+/**
+ * @brief error of the run second, C: T_Set - the PID input
+ */
+void ilcSample(unsigned int time, double error)
+{
+  if (active == NONE)
+    return;
+  sumSq += error * error;
+  samples++;
+  if (time < lead)
+    return;
+  unsigned int j = (time - lead) / bin;
+  if (j >= ILC_BINS)
+    return;
+
+  const long limit = (long)(ILC_LIMIT * ((1L << NEXT_Q) - (1L << (NEXT_Q - U_Q)))); //u[] stays within int8
+  long v = next[j] + (long)round(ILC_GAIN * error / bin * (1L << NEXT_Q));
+  next[j] = v > limit ? limit : (v < -limit ? -limit : v);
+}
+
+/**
+ * @brief the run reached the end of the profile: smoothed table for the next one
+ */
+void ilcEnd()
+{
+  if (active == NONE)
+    return;
+  IlcTable &t = table[active];
+  for (byte j = 0; j < used; j++) //the bins after the end stay 0 and are not smoothed into the last one
+  {
+    long left = next[j > 0 ? j - 1 : j];
+    long right = next[j < used - 1 ? j + 1 : j];
+    long v = (left + 2L * next[j] + right) / 4;
+    //to nearest, half away from zero: >> floors, a negative u would creep down a step a run
+    const long half = 1L << (NEXT_Q - U_Q - 1);
+    t.u[j] = v >= 0 ? (v + half) >> (NEXT_Q - U_Q) : -((-v + half) >> (NEXT_Q - U_Q));
+  }
+
+  t.stats.prev = t.stats.rms;
+  t.stats.rms = samples ? round(sqrt(sumSq / samples) * 100) : 0;
+  if (t.stats.runs < 255)
+    t.stats.runs++;
+  active = NONE;
+}
+
+/**
+ * @brief the run was cut short, nothing learned
+ */
+void ilcStop()
+{
+  active = NONE;
+}
+
+const IlcStats &ilcStats(byte profile)
+{
+  return table[profile].stats;
+}
+
+/**
+ * @brief convergence from the rms error of the last two learned runs
+ */
+byte ilcState(byte profile)
+{
+  const IlcStats &s = table[profile].stats;
+  if (s.runs == 0)
+    return ILC_NONE;
+  if (s.runs < 2)
+    return ILC_LEARNING;
+  if (s.rms > s.prev)
+    return ILC_DIVERGING;
+  return s.rms > s.prev * (1 - ILC_DROP) ? ILC_SETTLED : ILC_LEARNING;
+}
@@ -0,0 +1,64 @@
+#ifndef IHC_ILC_h
+#define IHC_ILC_h
+
+#include "ihc.h"
+
+/*
+	Iterative learning control for the profiles that select it (profile
+	screen, `ilc`). The tracking error of a run repeats in the next run of
+	the same profile, so a duty correction learned from it is added to the
+	PID's feed-forward (FeedBottom, on top of the profile feed-forward when
+	that is on) next time:
+
+	  u[j] += ILC_GAIN * mean error over bin j, shifted back by the lag
+
+	The profile is cut into ILC_BINS bins; the correction is read between
+	the bin centres. The error is the plate's, T_Set - the observer
+	estimate, sampled every profile second; the PID runs on the estimate
+	for the run too, whatever "o" says (on T_Bottom the learning would make
+	the lagging sensor track T_Set and the plate run ahead). It is shifted back by the plate model's lag because the duty
+	shows there that much later. Seconds with the heater already at the
+	limit the error asks for (full on and too cold, off and too hot: the
+	cool-down of a profile) are left out, of the learning and of the rms.
+	After a run that reached the end of the profile the new table is
+	smoothed [1 2 1] over the bins the profile reaches (Q-filter: keeps the
+	learning from picking up the noise and the bin-to-bin ripple it causes),
+	rounded to the nearest step and clamped to ILC_LIMIT. A run with no
+	error leaves a flat table as it was. A run stopped by hand learns
+	nothing.
+
+	The tables are in RAM, a byte a bin per profile: the settings record
+	has no room for them and a run would rewrite it every time. They start
+	from zero after a reset; a change to the profile's points, serial "c"
+	or a new profile length clears them too. The rms error of the last two
+	learned runs shows the convergence: learning while it drops by more
+	than ILC_DROP a run, settled while it drops by less, diverging when it
+	rose.
+*/
+
+#define ILC_BINS    32   //correction points per profile
+#ifndef ILC_GAIN
+#define ILC_GAIN    0.05 //duty per C of error, per run
+#endif
+#define ILC_LIMIT   1.0  //duty, largest correction either way
+#define ILC_DROP    0.1  //share the rms error has to drop by from run to run to be learning
+
+enum { ILC_NONE, ILC_LEARNING, ILC_SETTLED, ILC_DIVERGING };
+
+typedef struct IlcStatsStruct {
+    byte runs;          //learned from since the reset
+    unsigned int rms;   //C/100, last learned run
+    unsigned int prev;  //C/100, the run before
+} IlcStats;
+
+void ilcReset(byte profile);
+void ilcStart(byte profile, const ProfileS &points, double lag);
+double ilcCorrection(unsigned int time); //duty
+void ilcSample(unsigned int time, double error);
+void ilcEnd();
+void ilcStop();
+
+const IlcStats &ilcStats(byte profile);
+byte ilcState(byte profile);
+
+#endif
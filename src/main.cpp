@@ -2,8 +2,26 @@
 #include <U8g2lib.h>
 #include "max6675.h"
 #include <PID_my.h>
+#include <PID_fixed.h>
+#include <PID_v2.h>
 #include "GyverEncoder.h"
 #include <EEPROM.h>
+#include <stddef.h>
+#include "ihc.h"
+#include "profile.h"
+#include "scheduler.h"
+#include "ssr.h"
+#include "bench.h"
+#include "format.h"
+#include "telemetry.h"
+#include "recorder.h"
+#include "store.h"
+#include "sensor.h"
+#include "observer.h"
+#include "autotune.h"
+#include "ident.h"
+#include "ilc.h"
+#include "mpc.h"
 
 #ifdef U8X8_HAVE_HW_SPI
 #include <SPI.h>
@@ -12,32 +30,6 @@
 #include <Wire.h>
 #endif
 
-typedef struct ProfileStruct {
-    int temper_1;
-    int temper_2;
-    int temper_3;
-    int temper_4;
-    unsigned int timer_1; //в секундах
-    unsigned int timer_2;
-    unsigned int timer_3;
-    unsigned int timer_4;
-} ProfileS;
-
-struct EEpromStruct {
-    unsigned int Pulse;
-    unsigned int P;
-    double I;
-    unsigned int D;
-    double thermocorrection;
-    byte T_Ambient;
-    byte ErrorRate;
-    byte Mode;// 3-manual 2,1,0-prof
-    int T_manual;
-    unsigned int Time_entry_manual;
-    unsigned int Time_hold_manual;
-    ProfileS TProfile[3];
-};
-
 /////////////////////////////////////////////////////////////////////////////////display
 //128x64
 
@@ -60,18 +52,36 @@ const bool ENC_TYPE = 1;      //0 one-step, 1 two-step
 
 Encoder enc1(Pin_ENC_CLK, Pin_ENC_DT, Pin_ENC_SW,ENC_TYPE);
 
+//menu step multiplier by the time between detents
+const byte EncAccel[][2] = {
+  //ms  step
+  {25,  10},
+  {50,  5},
+  {100, 2},
+};
+
+//CLK/DT change: steps are queued, tick() takes them from loop() and the menus
+void encoderISR()
+{
+  enc1.isrTick();
+}
+
+#ifdef __AVR__
+ISR(PCINT2_vect) //pins 3, 4 - port D
+{
+  encoderISR();
+}
+#endif
+
 /////////////////////////////////////////////////////////////////////////////////SYS
 struct EEpromStruct EEprom; //data storage structure
 
 double InputBottom, OutBottom;
-unsigned long windowONTime;
+double FeedBottom; //feed-forward of the profile segment, added to the PID output
+bool FeedForward = false; //profile supplies FeedBottom, only with ObserverInput
 
 unsigned long Time;//current time
-unsigned long TimeCOM;//for timing COM
-unsigned long TimeMAX;//for timing MAX
-unsigned long TimePID;//for timing PID
-unsigned long TimeSSD;//for timing display
-unsigned long TimeProfile;//for timing Profile
+unsigned long TimeSSD;//for timing menu display
 
 byte ErrorRate_buf = 0;
 byte ErrorRate_count = 0; //counting iteration check
@@ -79,11 +89,145 @@ byte ErrorRate_count = 0; //counting iteration check
 bool on_off = false;
 byte ProfilStatus = 0; //profile stage
 unsigned long TimeProfileStart = 0;//launch time
+unsigned int Prof_Time_sec = 0;//s since launch
 
 double T_Bottom; //temperature from the sensor
 double T_Set; //specified temperature
-
+bool ObserverInput = false; //PID input: true - observer estimate, false - T_Bottom
+bool TuneSerial = false; //autotune or identification started over serial: no accept screen, "y" accepts
+double GainNow[3] = {-1}; //P, I, D the PID runs with, see gainSchedule()
+bool MpcRun = false; //this run is under mpc.h, the PID stays in manual
+bool IlcRun = false; //this run learns in ilc.h and takes its correction
+enum { CONTROL_PID, CONTROL_PID_ILC, CONTROL_MPC }; //profileControl(), the order of the profile screen field
+const char ControlNames[3][4] = {"pid", "ilc", "mpc"};
+
+ProfileTable Profile; //compiled current mode
+
+//main screen, one page per loop() pass
+typedef struct ScreenStruct {
+  char text[5][5]; //ProfilStatus, T_Set, T_Bottom, T_manual, Prof_Time_sec (stopped: ILC rms)
+  byte mode;
+  byte learn; //stopped, ilc.h profile: ilcState(), ILC_NONE - no line
+  bool on;
+  byte cursor; //progress cursor x, 0 - none
+} Screen;
+
+//profile graph of the main screen, rebuilt when the mode or the profiles change
+const byte graphX0 =44;
+const byte graphY0 =52;
+const byte graphX1 =120;
+const byte graphY1 =2;
+
+#define GRAPH_POINTS (2*PROFILE_POINTS + 1) //start, then a step and a ramp end per point
+#define GRAPH_NONE 0xFF
+
+typedef struct GraphStruct {
+  byte mode;          //mode the polyline is built for, GRAPH_NONE - rebuild
+  byte count;
+  byte x[GRAPH_POINTS];
+  byte y[GRAPH_POINTS];
+  unsigned int total; //s, profile length
+} Graph;
+
+Graph ProfileGraph = {GRAPH_NONE, 0, {0}, {0}, 0};
+
+Screen ScreenNext;  //frame being sent
+Screen ScreenShown; //frame on the display
+bool screenValid = false;
+bool framePending = false;
+unsigned long frameStart;
+DisplayStats DisplayStat;
+
+#if defined(PID_FIXED)
+PIDFixed<PID_FIXED> BottomPID(&InputBottom, &OutBottom, &T_Set, 3, 5, 1, DIRECT); //fixed point Q(31-PID_FIXED).PID_FIXED
+#elif defined(PID_V2)
+PIDv2 BottomPID(&InputBottom, &OutBottom, &T_Set, 3, 5, 1, DIRECT); //measured dt, filtered D on T, back-calculation
+#else
 PID BottomPID(&InputBottom, &OutBottom, &T_Set, 3, 5, 1, DIRECT);
+#endif
+
+#define PID_TASK   200 //ms, pidTask period
+#define PID_SAMPLE 250 //ms, SampleTime of PID and PIDFixed as constructed
+#if defined(PID_FIXED)
+#define GAIN_D_MAX (((1L << (31 - PID_FIXED)) - 1) * PID_SAMPLE / 1000) //kd = D / SampleTime in s stays in the fixed point range
+#else
+#define GAIN_D_MAX 60000
+#endif
+
+#define GAIN_BLEND 10 //C of T_Set over which a gain band takes over from the set below it
+#define CONFIG_VERSION 4 //layout of EEpromStruct in the store, append fields and bump it
+static_assert(sizeof(EEpromStruct) <= 255, "store record length is a byte");
+
+/**
+ * @brief gain bands off, each set a copy of EEprom.P/I/D
+ * 
+ */
+void gainDefaults()
+{
+  for(byte i = 0; i < GAIN_BANDS; i++)
+  {
+    EEprom.Gain[i].from = 0;
+    EEprom.Gain[i].P = EEprom.P;
+    EEprom.Gain[i].I = EEprom.I;
+    EEprom.Gain[i].D = EEprom.D;
+  }
+}
+
+/**
+ * @brief P, I and D of a gain set
+ * 
+ * @param set - 0 - EEprom.P/I/D, n - EEprom.Gain[n-1]
+ */
+void gainSet(byte set, double gain[3])
+{
+  gain[0] = set == 0 ? EEprom.P : EEprom.Gain[set-1].P;
+  gain[1] = set == 0 ? EEprom.I : EEprom.Gain[set-1].I;
+  gain[2] = set == 0 ? EEprom.D : EEprom.Gain[set-1].D;
+}
+
+/**
+ * @brief band with the highest start at or below T, 0 - none
+ * 
+ */
+byte gainBand(double T)
+{
+  byte band = 0;
+  unsigned int from = 0;
+  for(byte i = 0; i < GAIN_BANDS; i++)
+    if (EEprom.Gain[i].from != 0 && EEprom.Gain[i].from <= T && EEprom.Gain[i].from > from)
+    {
+      band = i + 1;
+      from = EEprom.Gain[i].from;
+    }
+  return band;
+}
+
+/**
+ * @brief PID gains for T_Set: those of its band, blended from the set below
+ * over the first GAIN_BLEND C of the band, so a switch while running moves
+ * the gains a little per PID step; the PID takes each change bumpless
+ * 
+ */
+void gainSchedule()
+{
+  double gain[3];
+  byte band = gainBand(T_Set);
+  gainSet(band, gain);
+  if (band != 0 && T_Set < EEprom.Gain[band-1].from + GAIN_BLEND)
+  {
+    double below[3];
+    gainSet(gainBand(EEprom.Gain[band-1].from - 0.5), below);
+    double w = (T_Set - EEprom.Gain[band-1].from) / GAIN_BLEND;
+    for(byte i = 0; i < 3; i++)
+      gain[i] = below[i] + (gain[i] - below[i]) * w;
+  }
+
+  if (gain[0] == GainNow[0] && gain[1] == GainNow[1] && gain[2] == GainNow[2])
+    return;
+  for(byte i = 0; i < 3; i++)
+    GainNow[i] = gain[i];
+  BottomPID.SetTuningsBumpless(gain[0], gain[1], gain[2]);
+}
 
 /**
  * @brief data reading function
@@ -91,39 +235,61 @@ PID BottomPID(&InputBottom, &OutBottom, &T_Set, 3, 5, 1, DIRECT);
  */
 void getEEPROM ()
 {
-  if (EEPROM.read(0) != 110) 
+  EEprom.Mode = 0;  // 3-manual 2,1,0-profile
+  
+  EEprom.T_manual = 225;
+  EEprom.T_Ambient = 25;
+  EEprom.Time_entry_manual = 60;
+  EEprom.Time_hold_manual = 20; //0 - indefinitely
+  
+  EEprom.thermocorrection = 0;
+  EEprom.ErrorRate = 80; 
+  EEprom.P = 50;
+  EEprom.I = 0.1;
+  EEprom.D = 20;
+  EEprom.Pulse = 500;
+  gainDefaults();
+  EEprom.Control = 0;
+  EEprom.Model.rise = OBSERVER_RISE;
+  EEprom.Model.tau = OBSERVER_TAU;
+  EEprom.Model.lag = OBSERVER_LAG;
+
+  //first start profiles
+  for(byte i = 0; i < 3; i++)
+    profileDefault(EEprom.TProfile[i]);
+
+  byte version = CONFIG_VERSION;
+  if (!storeLoad(&EEprom, sizeof(EEprom), version))
   {
-    EEprom.Mode = 0;  // 3-manual 2,1,0-profile
-    
-    EEprom.T_manual = 225;
-    EEprom.T_Ambient = 25;
-    EEprom.Time_entry_manual = 60;
-    EEprom.Time_hold_manual = 20; //0 - indefinitely
-    
-    EEprom.thermocorrection = 0;
-    EEprom.ErrorRate = 80; 
-    EEprom.P = 50;
-    EEprom.I = 0.1;
-    EEprom.D = 20;
-    EEprom.Pulse = 500;
-
-    /*//first start profiles
-    for(byte i = 0; i < 3; i++)
+    //image of the firmware before the store: magic byte at 0, EEpromStruct at 1
+    byte magic = EEPROM.read(0);
+    if (magic == 110 || magic == 111)
+    {
+      version = 1; //its layout ends at TProfile, what follows keeps the defaults
+      for(byte i = 0; i < offsetof(EEpromStruct, Gain); i++)
+        ((byte *)&EEprom)[i] = EEPROM.read(1 + i);
+    }
+    if (magic == 110) //4-phase profiles, everything before TProfile is unchanged
     {
-      EEprom.TProfile[0].temper_1 = 145;
-      EEprom.TProfile[0].temper_2 = 200;
-      EEprom.TProfile[0].temper_3 = 250;
-      EEprom.TProfile[0].temper_4 = 100;
-      EEprom.TProfile[0].timer_1 = 120;
-      EEprom.TProfile[0].timer_2 = 90;
-      EEprom.TProfile[0].timer_3 = 60;
-      EEprom.TProfile[0].timer_4 = 60;
-    }*/
-
-    EEPROM.put(1, EEprom);
-    EEPROM.update(0, 110);  //noted data availability
-  }
-  EEPROM.get(1, EEprom);
+      struct {
+        int temper[4];
+        unsigned int timer[4];
+      } phases;
+
+      for(byte i = 0; i < 3; i++)
+      {
+        EEPROM.get(1 + offsetof(EEpromStruct, TProfile) + i*sizeof(phases), phases);
+        profileFromPhases(EEprom.TProfile[i], phases.temper, phases.timer);
+      }
+    }
+  }
+  //version < CONFIG_VERSION: fields it did not have keep the defaults above,
+  //fix up the ones whose meaning changed here
+  if (version < 2) //gain bands, from the stored gains
+    gainDefaults();
+
+  storeSave(&EEprom, sizeof(EEprom), CONFIG_VERSION); //nothing written if already current
+  observerSetModel(EEprom.Model);
   T_Set = EEprom.T_Ambient;
 }
 
@@ -133,7 +299,45 @@ void getEEPROM ()
  */
 void saveEEPROM () 
 {
-  EEPROM.put(1, EEprom);
+  storeSave(&EEprom, sizeof(EEprom), CONFIG_VERSION);
+}
+
+/**
+ * @brief what controls the plate in the mode: CONTROL_PID for manual
+ * 
+ */
+byte profileControl(byte mode)
+{
+  if (mode >= 3)
+    return CONTROL_PID;
+  if (EEprom.Control >> mode & 1)
+    return CONTROL_MPC;
+  return EEprom.Control >> (CONTROL_ILC + mode) & 1 ? CONTROL_PID_ILC : CONTROL_PID;
+}
+
+/**
+ * @brief sets what controls the plate in profile mode
+ * 
+ */
+void profileSetControl(byte mode, byte control)
+{
+  EEprom.Control &= ~(1 << mode | 1 << (CONTROL_ILC + mode));
+  if (control == CONTROL_MPC)
+    EEprom.Control |= 1 << mode;
+  else if (control == CONTROL_PID_ILC)
+    EEprom.Control |= 1 << (CONTROL_ILC + mode);
+}
+
+/**
+ * @brief compiles the current mode into the profile table,
+ * called at the start of a run and whenever the mode is edited while running
+ */
+void compileProfile()
+{
+  if(EEprom.Mode < 3)
+    profileCompile(Profile, EEprom.TProfile[EEprom.Mode], EEprom.T_Ambient);
+  else
+    profileCompileManual(Profile, EEprom.T_manual, EEprom.Time_entry_manual, EEprom.Time_hold_manual, EEprom.T_Ambient);
 }
 
 /**
@@ -151,23 +355,290 @@ void RunHot(byte MODE)
     u8g2.setDrawColor(1);
     u8g2.drawStr(48, 35, "RUN");
   } while ( u8g2.nextPage() );
-  Serial.print("RUN");
+  Serial.print(F("RUN"));
   Serial.print("\n");
   delay(1000);
 
   EEprom.Mode = MODE;
+  compileProfile();
 
   OutBottom = 0;
+  FeedBottom = 0;
   ErrorRate_count = 0;
   ErrorRate_buf = 0;
   ProfilStatus = 0;
   TimeProfileStart = millis();
 
-  BottomPID.SetTunings(EEprom.P,EEprom.I,EEprom.D);
-  BottomPID.SetMode(AUTOMATIC);
-  //windowONTime = millis();
+  BottomPID.SetOutputLimits(0, EEprom.Pulse);
+  GainNow[0] = -1; //PID still in manual: plain SetTunings
+  gainSchedule();
+  MpcRun = profileControl(EEprom.Mode) == CONTROL_MPC;
+  if (MpcRun)
+    mpcStart(observerModel(), EEprom.T_Ambient, millis());
+  else
+    BottomPID.SetMode(AUTOMATIC);
+  IlcRun = profileControl(EEprom.Mode) == CONTROL_PID_ILC;
+  if (IlcRun)
+    ilcStart(EEprom.Mode, EEprom.TProfile[EEprom.Mode], observerModel().lag);
+  ssrBegin(Pin_HOT, EEprom.Pulse);
+  recorderStart(EEprom.Mode, EEprom.Pulse);
   
   on_off = true;
+
+  schedulerStart(Tasks, TASKS, millis());
+  schedulerSetPeriod(Tasks[TASK_DISPLAY], 500, millis());
+  displayRestart();
+}
+
+/**
+ * @brief autotune or identification in progress: it drives the heater,
+ * no profile and no thermocouple test
+ * 
+ */
+bool TestRunning()
+{
+  return autotuneState() == AUTOTUNE_RUNNING || identState() == IDENT_RUNNING;
+}
+
+/**
+ * @brief heater on for a test instead of a run, the PID is off meanwhile;
+ * the caller starts the test
+ * 
+ * @param name - on the screen and Serial
+ * @param set - T_Set shown while it runs
+ */
+void TestHot(const char *name, double set)
+{
+  u8g2.firstPage();
+  do {
+    u8g2.setFontMode(1);
+    u8g2.setFont(u8g2_font_6x10_tf);
+    u8g2.setDrawColor(1);
+    u8g2.drawStr(42, 35, name);
+  } while ( u8g2.nextPage() );
+  Serial.print(name);
+  Serial.print("\n");
+  delay(1000);
+
+  OutBottom = 0;
+  FeedBottom = 0;
+  ErrorRate_count = 0;
+  ErrorRate_buf = 0;
+  ProfilStatus = 0;
+  TimeProfileStart = millis();
+  T_Set = set;
+
+  BottomPID.SetMode(MANUAL);
+  ssrBegin(Pin_HOT, EEprom.Pulse);
+
+  on_off = true;
+
+  schedulerStart(Tasks, TASKS, millis());
+  schedulerSetPeriod(Tasks[TASK_DISPLAY], 500, millis());
+  displayRestart();
+}
+
+/**
+ * @brief starts the relay autotune at AUTOTUNE_SET
+ * 
+ */
+void TuneHot()
+{
+  TestHot("TUNE", AUTOTUNE_SET);
+  autotuneStart(AUTOTUNE_SET, EEprom.Pulse, millis());
+}
+
+/**
+ * @brief starts the step response identification from a cold plate
+ * 
+ */
+void IdentHot()
+{
+  TestHot("IDENT", EEprom.T_Ambient);
+  identStart(EEprom.T_Ambient, EEprom.Pulse, millis());
+}
+
+/**
+ * @brief result of a test with OK/NO under it, turn to choose, press to close
+ * 
+ * @param label - of the three lines
+ * @param done - false: NO only
+ * @return OK chosen
+ */
+bool testScreen(const char *title, const char *label[3], char line[3][14], bool done)
+{
+  bool accept = done;
+  bool redraw = true;
+  while(true)
+  {
+    enc1.tick();
+    if (enc1.isTurn())
+    {
+      accept = done && !accept;
+      redraw = true;
+    }
+    if (enc1.isPress())
+      return accept;
+
+    if (redraw)
+    {
+      u8g2.firstPage();
+      do {
+        u8g2.setFontMode(1);
+        u8g2.setFont(u8g2_font_6x10_tf);
+        u8g2.setDrawColor(1);
+        u8g2.drawStr(2, 10, title);
+        for(byte i = 0; i < 3; i++)
+        {
+          u8g2.drawStr(4, 25 + 12*i, label[i]);
+          u8g2.drawStr(4 + 6 + 6*strlen(label[i]), 25 + 12*i, line[i]);
+        }
+        u8g2.drawStr(28, 61, " OK ");
+        u8g2.drawStr(76, 61, " NO ");
+        u8g2.setDrawColor(2);
+        u8g2.drawBox(accept ? 28 : 76, 53, 24, 10);
+      } while(u8g2.nextPage());
+      redraw = false;
+    }
+  }
+}
+
+/**
+ * @brief the autotune tunings (Kp, Ki per s, Kd in s) in the units of the
+ * BottomPID compiled in, within the ranges of the settings fields
+ *
+ * PIDv2 takes them as they are. PID and PIDFixed multiply Ki by SampleTime
+ * and add it once a Compute(), which pidTask gets every PID_TASK ms once
+ * PID_SAMPLE has passed: every 400 ms. Their D is divided by SampleTime in
+ * s and by the elapsed ms again. So
+ *   I = Ki * 400 / PID_SAMPLE,  D = Kd * PID_SAMPLE
+ */
+void tuneGains(const AutotuneResult &result, unsigned int &P, double &I, unsigned int &D)
+{
+#if defined(PID_V2)
+  double ki = result.ki;
+  double kd = result.kd;
+#else
+  const unsigned int every = (PID_SAMPLE + PID_TASK - 1) / PID_TASK * PID_TASK; //ms between computes
+  double ki = result.ki * every / PID_SAMPLE;
+  double kd = result.kd * PID_SAMPLE;
+#endif
+  P = result.kp < 3000 ? round(result.kp) : 3000;
+  I = ki < 50 ? ki : 50; //not rounded to the 0.01 shown: a slow plate has a small I
+  D = kd < GAIN_D_MAX ? round(kd) : GAIN_D_MAX;
+}
+
+/**
+ * @brief stores the autotune tunings as P, I, D
+ * 
+ */
+void tuneAccept()
+{
+  tuneGains(autotuneResult(), EEprom.P, EEprom.I, EEprom.D);
+  saveEEPROM();
+  autotuneStop();
+  Serial.print(F("TUNE stored\n"));
+}
+
+/**
+ * @brief end of the autotune: result on Serial, then the accept screen
+ * (over serial "y" accepts instead)
+ * 
+ */
+void tuneDone()
+{
+  const AutotuneResult &result = autotuneResult();
+  bool done = autotuneState() == AUTOTUNE_DONE;
+  StopHot();
+
+  char line[3][14] = {"FAILED", "", ""};
+  if (done)
+  {
+    unsigned int P, D;
+    double I;
+    tuneGains(result, P, I, D);
+    byte len = fmtInt(line[0], sizeof(line[0]), P, " I ");
+    fmtFixed(line[0] + len, sizeof(line[0]) - len, round(I * 100), 2);
+    len = fmtInt(line[1], sizeof(line[1]), D, " Pu ");
+    fmtInt(line[1] + len, sizeof(line[1]) - len, round(result.pu), "s");
+    len = fmtFixed(line[2], sizeof(line[2]), round(result.ku * 10), 1, " a ");
+    fmtFixed(line[2] + len, sizeof(line[2]) - len, round(result.amplitude * 10), 1, "C");
+  }
+  if (done)
+  {
+    Serial.print(F("TUNE P "));
+    Serial.print(line[0]);
+    Serial.print(F(" D "));
+    Serial.print(line[1]);
+    Serial.print(F(" Ku "));
+    Serial.print(line[2]);
+    Serial.print("\n");
+  }
+  else
+    Serial.print(F("TUNE FAILED\n"));
+
+  if (TuneSerial)
+    return;
+
+  const char *label[3] = {"P", "D", "Ku"};
+  if (testScreen("Autotune", label, line, done))
+    tuneAccept();
+  else
+    autotuneStop();
+  displayRestart();
+}
+
+/**
+ * @brief stores the identified plate model, the observer, feed-forward
+ * and mpc.h take it at once
+ * 
+ */
+void identAccept()
+{
+  EEprom.Model = identResult();
+  observerSetModel(EEprom.Model);
+  saveEEPROM();
+  identStop();
+  Serial.print(F("MODEL stored\n"));
+}
+
+/**
+ * @brief end of the identification: result on Serial, then the accept
+ * screen (over serial "y" accepts instead)
+ * 
+ */
+void identDone()
+{
+  const PlantModel &result = identResult();
+  bool done = identState() == IDENT_DONE;
+  StopHot();
+
+  char line[3][14] = {"FAILED", "", ""};
+  if (done)
+  {
+    fmtFixed(line[0], sizeof(line[0]), round(result.rise * 100), 2, "C/s");
+    fmtInt(line[1], sizeof(line[1]), round(result.tau), "s");
+    fmtFixed(line[2], sizeof(line[2]), round(result.lag * 10), 1, "s");
+    Serial.print(F("MODEL rise "));
+    Serial.print(line[0]);
+    Serial.print(F(" tau "));
+    Serial.print(line[1]);
+    Serial.print(F(" lag "));
+    Serial.print(line[2]);
+    Serial.print("\n");
+  }
+  else
+    Serial.print(F("MODEL FAILED\n"));
+
+  if (TuneSerial)
+    return;
+
+  const char *label[3] = {"rise", "tau", "lag"};
+  if (testScreen("Model", label, line, done))
+    identAccept();
+  else
+    identStop();
+  displayRestart();
 }
 
 /**
@@ -183,13 +654,19 @@ void StopHot()
     u8g2.setDrawColor(1);
     u8g2.drawStr(48, 35, "STOP");
   } while ( u8g2.nextPage() );
-  Serial.print("STOP");
+  Serial.print(F("STOP"));
   Serial.print("\n");
 
-  digitalWrite(Pin_HOT, 0);
+  ssrStop();
+  recorderStop();
+  if (autotuneState() == AUTOTUNE_RUNNING) //stopped by hand
+    autotuneStop();
+  if (identState() == IDENT_RUNNING)
+    identStop();
   delay(1000);
 
   OutBottom = 0;
+  FeedBottom = 0;
   ErrorRate_count = 0;
   ErrorRate_buf = 0;
   ProfilStatus = 0;
@@ -197,22 +674,54 @@ void StopHot()
   T_Set = EEprom.T_Ambient;
 
   BottomPID.SetMode(MANUAL);
+  MpcRun = false;
+  if (IlcRun) //stopped before the end
+    ilcStop();
+  IlcRun = false;
   
   on_off = false;
+
+  schedulerStart(Tasks, TASKS, millis());
+  schedulerSetPeriod(Tasks[TASK_DISPLAY], 100, millis());
+  displayRestart();
+}
+
+/**
+ * @brief adds step to value and keeps it within [min, max]
+ */
+int stepValue(int value, int step, int min, int max)
+{
+  value += step;
+  return value < min ? min : (value > max ? max : value);
+}
+
+/**
+ * @brief signed step of the last detent, scaled by the rotation speed
+ */
+int encoderStep()
+{
+  if (enc1.isRight())
+    return enc1.getAccel();
+  if (enc1.isLeft())
+    return -enc1.getAccel();
+  return 0;
+}
+
+/**
+ * @brief changes the number of points, new points repeat the last one
+ */
+void resizeProfile(ProfileS &profile, int count)
+{
+  count = stepValue(count, 0, 1, PROFILE_POINTS);
+  for(byte i = profile.count; i < count; i++)
+    profile.point[i] = profile.point[i-1];
+  profile.count = count;
 }
 
 void menu1()
 {
   byte menu_pos = 0;
   bool menu_edit = true;
-  void* structure_field[8] = { &EEprom.TProfile[EEprom.Mode].temper_1, 
-                                        &EEprom.TProfile[EEprom.Mode].temper_2, 
-                                        &EEprom.TProfile[EEprom.Mode].temper_3,
-                                        &EEprom.TProfile[EEprom.Mode].temper_4, 
-                                        &EEprom.TProfile[EEprom.Mode].timer_1,
-                                        &EEprom.TProfile[EEprom.Mode].timer_2, 
-                                        &EEprom.TProfile[EEprom.Mode].timer_3,
-                                        &EEprom.TProfile[EEprom.Mode].timer_4};
   TimeSSD = millis();
 
   while(true)
@@ -229,50 +738,49 @@ void menu1()
     if (enc1.isPress())
       menu_edit = !menu_edit;
 
-    if (EEprom.Mode < 3)//profile
+    if (EEprom.Mode < 3)//profile: 0 - number of points, 1 - PID/ILC/MPC, then time/temperature/type of each point
     {
+      ProfileS &profile = EEprom.TProfile[EEprom.Mode];
+
       if (enc1.isTurn()) 
       {
         if (menu_edit == false)
         {
           if (enc1.isRight()) 
-            menu_pos < 7 ? menu_pos++: menu_pos = 7;
+            menu_pos < profile.count*3+1 ? menu_pos++: menu_pos = profile.count*3+1;
           if (enc1.isLeft())
             menu_pos > 0 ? menu_pos--: menu_pos = 0;
         }
         else
         {
-          if (enc1.isRight())
-          {
-            if (menu_pos < 4)
-              *((int*)structure_field[menu_pos]) < 400 ? *((int*)structure_field[menu_pos]) += 1: *((int*)structure_field[menu_pos]) = 400; 
-            else
-              *((unsigned int*)structure_field[menu_pos]) < 999 ? *((unsigned int*)structure_field[menu_pos]) += 1: *((unsigned int*)structure_field[menu_pos]) = 999;
-          }
+          int step = encoderStep();
 
-          if (enc1.isLeft())
+          if (menu_pos != 1 && step != 0) //what was learned was for the old points
+            ilcReset(EEprom.Mode);
+          if (menu_pos == 0)
+            resizeProfile(profile, profile.count + (step > 0) - (step < 0));
+          else if (menu_pos == 1)
           {
-            if (menu_pos < 4)
-              *((int*)structure_field[menu_pos]) > EEprom.T_Ambient ? *((int*)structure_field[menu_pos]) -= 1: *((int*)structure_field[menu_pos]) = EEprom.T_Ambient; 
-            else
-              *((unsigned int*)structure_field[menu_pos]) > 5 ? *((unsigned int*)structure_field[menu_pos]) -= 1: *((unsigned int*)structure_field[menu_pos]) = 5;
+            if (step != 0) //pid -> ilc -> mpc -> pid
+              profileSetControl(EEprom.Mode, (profileControl(EEprom.Mode) + (step > 0 ? 1 : 2)) % 3);
           }
-
-          if (enc1.isFastR())
+          else
           {
-            if (menu_pos < 4)
-              *((int*)structure_field[menu_pos]) < 400-3 ? *((int*)structure_field[menu_pos]) += 3: *((int*)structure_field[menu_pos]) = 400; 
-            else
-              *((unsigned int*)structure_field[menu_pos]) < 999-3 ? *((unsigned int*)structure_field[menu_pos]) += 3: *((unsigned int*)structure_field[menu_pos]) = 999;
+            ProfilePoint &point = profile.point[(menu_pos-2)/3];
+            switch ((menu_pos-2)%3)
+            {
+              case 0:
+                point.time = stepValue(point.time, step, 1, PROFILE_TIME_MAX);
+                break;
+              case 1:
+                point.temper = stepValue(point.temper, step, EEprom.T_Ambient, PROFILE_TEMPER_MAX);
+                break;
+              case 2:
+                if (step != 0)
+                  point.step = !point.step;
+                break;
+            }
           }
-
-          if (enc1.isFastL())
-          {
-            if (menu_pos < 4)
-              *((int*)structure_field[menu_pos]) > EEprom.T_Ambient+3 ? *((int*)structure_field[menu_pos]) -= 3: *((int*)structure_field[menu_pos]) = EEprom.T_Ambient; 
-            else
-              *((unsigned int*)structure_field[menu_pos]) > 5+3 ? *((unsigned int*)structure_field[menu_pos]) -= 3: *((unsigned int*)structure_field[menu_pos]) = 5;
-          } 
         }
       }
     }
@@ -289,69 +797,47 @@ void menu1()
         }
         else
         {
-          void* structure_field[3] = {&EEprom.T_manual, &EEprom.Time_entry_manual, &EEprom.Time_hold_manual};
-          
-          if (enc1.isRight())
-          {
-            if (menu_pos == 0)
-              *((int*)structure_field[menu_pos]) < 400 ? *((int*)structure_field[menu_pos]) += 1: *((int*)structure_field[menu_pos]) = 400; 
-            else
-              *((unsigned int*)structure_field[menu_pos]) < 999 ? *((unsigned int*)structure_field[menu_pos]) += 1: *((unsigned int*)structure_field[menu_pos]) = 999;
-          }
-
-          if (enc1.isLeft())
-          {
-            if (menu_pos == 0)
-              *((int*)structure_field[menu_pos]) > EEprom.T_Ambient ? *((int*)structure_field[menu_pos]) -= 1: *((int*)structure_field[menu_pos]) = EEprom.T_Ambient; 
-            else
-              if (menu_pos == 1)
-                *((unsigned int*)structure_field[menu_pos]) > 5 ? *((unsigned int*)structure_field[menu_pos]) -= 1: *((unsigned int*)structure_field[menu_pos]) = 5;
-              else
-                *((unsigned int*)structure_field[menu_pos]) > 0 ? *((unsigned int*)structure_field[menu_pos]) -= 1: *((unsigned int*)structure_field[menu_pos]) = 0;
-          }
-
-          if (enc1.isFastR())
+          int step = encoderStep();
+          switch (menu_pos)
           {
-            if (menu_pos == 0)
-              *((int*)structure_field[menu_pos]) < 400-3 ? *((int*)structure_field[menu_pos]) += 3: *((int*)structure_field[menu_pos]) = 400; 
-            else
-              *((unsigned int*)structure_field[menu_pos]) < 999-3 ? *((unsigned int*)structure_field[menu_pos]) += 3: *((unsigned int*)structure_field[menu_pos]) = 999;
+            case 0:
+              EEprom.T_manual = stepValue(EEprom.T_manual, step, EEprom.T_Ambient, 400);
+              break;
+            case 1:
+              EEprom.Time_entry_manual = stepValue(EEprom.Time_entry_manual, step, 5, 999);
+              break;
+            case 2:
+              EEprom.Time_hold_manual = stepValue(EEprom.Time_hold_manual, step, 0, 999);
+              break;
           }
-
-          if (enc1.isFastL())
-          {
-            if (menu_pos == 0)
-              *((int*)structure_field[menu_pos]) > EEprom.T_Ambient+3 ? *((int*)structure_field[menu_pos]) -= 3: *((int*)structure_field[menu_pos]) = EEprom.T_Ambient; 
-            else
-              if (menu_pos == 1)
-                *((unsigned int*)structure_field[menu_pos]) > 5+3 ? *((unsigned int*)structure_field[menu_pos]) -= 3: *((unsigned int*)structure_field[menu_pos]) = 5;
-              else
-                *((unsigned int*)structure_field[menu_pos]) > 0+3 ? *((unsigned int*)structure_field[menu_pos]) -= 3: *((unsigned int*)structure_field[menu_pos]) = 0;
-         }
         }
       }
     }
     
-    if(Time > TimeSSD + 500)
+    if(Time - TimeSSD > 500)
     {
       if (EEprom.Mode < 3) 
       {
-        String str;
-        char tmpMode[3] = {};
-        char tmpNum[8][4] = {};
+        const ProfileS &profile = EEprom.TProfile[EEprom.Mode];
+        const byte fieldX[3] = {20, 56, 92}; //time, temperature, type
+        byte row = menu_pos < 2 ? 0 : (menu_pos-2)/3;
+        byte first = row < 4 ? 0 : row - 3; //4 visible rows
+        char tmpMode[3] = "M";
+        char tmpCount[5] = "n:";
+        char tmpIdx[4][3] = {};
+        char tmpNum[4][3][5] = {};
         
-        //data preparation, conversion to Str
-        str = "M" + String(EEprom.Mode+1);
-        str.toCharArray(tmpMode,3);
+        //data preparation
+        fmtInt(tmpMode+1, 2, EEprom.Mode+1);
+        fmtInt(tmpCount+2, 3, profile.count);
         
-        for(byte i = 0; i < 8; i++)
+        for(byte i = 0; i < 4 && first + i < profile.count; i++)
         {
-          if(i < 4)
-            str = String(*((int*)structure_field[i])) + "C";
-          else
-            str = String(*((unsigned int*)structure_field[i])) + "s";
-
-          str.toCharArray(tmpNum[i],4);
+          const ProfilePoint &point = profile.point[first + i];
+          fmtInt(tmpIdx[i], 3, first + i + 1);
+          fmtInt(tmpNum[i][0], 5, point.time, "s");
+          fmtInt(tmpNum[i][1], 5, point.temper, "C");
+          memcpy(tmpNum[i][2], point.step ? "step" : "ramp", 5);
         }
 
         //output
@@ -360,50 +846,42 @@ void menu1()
           u8g2.setFontMode(1);
           u8g2.setFont(u8g2_font_6x10_tf);
           u8g2.setDrawColor(1);
-          u8g2.drawStr(2, 10, "Configuration");
-          u8g2.drawStr(100, 10, tmpMode);
-          
-          u8g2.drawStr(4, 25, "T1");
-          u8g2.drawStr(4, 37, "T2");
-          u8g2.drawStr(4, 49, "T3");
-          u8g2.drawStr(4, 61, "T4");
+          u8g2.drawStr(2, 10, "Profile");
+          u8g2.drawStr(56, 10, tmpCount);
+          u8g2.drawStr(88, 10, ControlNames[profileControl(EEprom.Mode)]);
+          u8g2.drawStr(114, 10, tmpMode);
 
-          
-          u8g2.drawStr(66, 25, "t1");
-          u8g2.drawStr(66, 37, "t2");
-          u8g2.drawStr(66, 49, "t3");
-          u8g2.drawStr(66, 61, "t4");
+          for(byte i = 0; i < 4 && first + i < profile.count; i++)
+          {
+            u8g2.drawStr(2, 25 + 12*i, tmpIdx[i]);
+            for(byte j = 0; j < 3; j++)
+              u8g2.drawStr(fieldX[j], 25 + 12*i, tmpNum[i][j]);
+          }
 
-          for(byte i = 0; i < 8; i++)
+          //selected field: frame to move, filled to edit
+          byte boxX = menu_pos == 0 ? 54 : (menu_pos == 1 ? 86 : fieldX[(menu_pos-2)%3] - 2);
+          byte boxY = menu_pos < 2 ? 1 : 16 + (row - first)*12;
+          byte boxW = menu_pos == 1 ? 22 : 28;
+          if (menu_edit == true)
           {
-            if(i<4)
-            {
-              u8g2.drawStr(4+25, 25 + 12*i, tmpNum[i]);
-              //delay(10);
-            }
-            else
-            {
-              u8g2.drawStr(66+25, 25 + 12*(i-4), tmpNum[i]);
-              //delay(10);
-            }
-            
+            u8g2.setDrawColor(2); 
+            u8g2.drawBox(boxX, boxY, boxW, 11);
           }
-          u8g2.setDrawColor(2); 
-          u8g2.drawBox((menu_pos<4 ? 2 : 64) + (menu_edit == true ? 25:0), 16 + (menu_pos<4 ? menu_pos: menu_pos-4)*12 , 18+ (menu_edit == true ? 15:0), 11);
+          else
+            u8g2.drawFrame(boxX, boxY, boxW, 11);
         } while(u8g2.nextPage());
       }
       else
       {
         char tmpNum[3][5] = {};
-        String str;
        
-        //data preparation, conversion to Str
-        str = String(round(EEprom.T_manual)) + "C";
-        str.toCharArray(tmpNum[0],5);
-        str = String(EEprom.Time_entry_manual) + "s";
-        str.toCharArray(tmpNum[1],5);
-        str = EEprom.Time_hold_manual != 0 ? String(EEprom.Time_hold_manual) + "s": "++";
-        str.toCharArray(tmpNum[2],5);
+        //data preparation
+        fmtInt(tmpNum[0], 5, EEprom.T_manual, "C");
+        fmtInt(tmpNum[1], 5, EEprom.Time_entry_manual, "s");
+        if (EEprom.Time_hold_manual != 0)
+          fmtInt(tmpNum[2], 5, EEprom.Time_hold_manual, "s");
+        else
+          memcpy(tmpNum[2], "++", 3);
 
         //output
         u8g2.firstPage();
@@ -431,11 +909,39 @@ void menu1()
   }
 }
 
-void menu2()
+//settings fields in screen order, at menu_pos MENU2_FIELD + field; FIELD_TEST is the tu / id line
+enum { FIELD_PULSE, FIELD_P, FIELD_D, FIELD_I, FIELD_CORRECTION, FIELD_AMBIENT, FIELD_ERROR_RATE, FIELDS, FIELD_TEST = FIELDS };
+#define MENU2_FIELD 2                           //menu_pos 0 - gain set, 1 - its start T
+#define MENU2_TUNE  (MENU2_FIELD + FIELD_TEST)  //tu, autotune
+#define MENU2_IDENT (MENU2_TUNE + 1)            //id on the model page
+
+/**
+ * @brief points the P, D and I fields of the settings screen at a gain set
+ * 
+ * @param band - 0 - EEprom.P/I/D, 1..GAIN_BANDS - EEprom.Gain[band-1]
+ */
+void gainFields(byte band, void* structure_field[])
 {
-  byte menu_pos = 0;
+  if (band == 0)
+  {
+    structure_field[FIELD_P] = &EEprom.P;
+    structure_field[FIELD_D] = &EEprom.D;
+    structure_field[FIELD_I] = &EEprom.I;
+  }
+  else
+  {
+    structure_field[FIELD_P] = &EEprom.Gain[band-1].P;
+    structure_field[FIELD_D] = &EEprom.Gain[band-1].D;
+    structure_field[FIELD_I] = &EEprom.Gain[band-1].I;
+  }
+}
+
+void menu2()
+{
+  byte menu_pos = MENU2_FIELD;
   bool menu_edit = true;
-  void* structure_field[7] = {&EEprom.Pulse, 
+  byte band = 0;
+  void* structure_field[FIELDS] = {&EEprom.Pulse, 
                               &EEprom.P, 
                               &EEprom.D,
                               &EEprom.I, 
@@ -457,107 +963,184 @@ void menu2()
     }
 
     if (enc1.isPress())
+    {
+      if (menu_pos == MENU2_TUNE)
+      {
+        saveEEPROM();
+        TuneSerial = false;
+        TuneHot();
+        return;
+      }
+      if (menu_pos == MENU2_IDENT)
+      {
+        saveEEPROM();
+        TuneSerial = false;
+        IdentHot();
+        return;
+      }
       menu_edit = !menu_edit;
+    }
 
     if (enc1.isTurn()) 
     {
       if (menu_edit == false)
       {
         if (enc1.isRight()) 
-          menu_pos < 6 ? menu_pos++: menu_pos = 6;
+          menu_pos < MENU2_IDENT ? menu_pos++: menu_pos = MENU2_IDENT;
         if (enc1.isLeft())
           menu_pos > 0 ? menu_pos--: menu_pos = 0;
       }
-      else
+      else if (menu_pos < MENU2_FIELD)
       {
+        int step = 0;
+        if (enc1.isRight()) step += 1;
+        if (enc1.isLeft()) step -= 1;
+        if (enc1.isFastR()) step += 3;
+        if (enc1.isFastL()) step -= 3;
+
+        if (menu_pos == 0)
+        {
+          int next = band + (step > 0 ? 1 : (step < 0 ? -1 : 0));
+          band = next < 0 ? 0 : (next > GAIN_BANDS ? GAIN_BANDS : next);
+          gainFields(band, structure_field);
+        }
+        else if (band != 0)
+        {
+          int from = (int)EEprom.Gain[band-1].from + step;
+          EEprom.Gain[band-1].from = from < 0 ? 0 : (from > PROFILE_TEMPER_MAX ? PROFILE_TEMPER_MAX : from);
+        }
+      }
+      else if (menu_pos < MENU2_TUNE)
+      {
+        byte field = menu_pos - MENU2_FIELD;
+        const unsigned int top = field == FIELD_D ? GAIN_D_MAX : 3000; //D holds what autotune stores
+
         if (enc1.isRight())
         {
-          if (menu_pos >= 0 && menu_pos < 3)
-            *((unsigned int*)structure_field[menu_pos]) < 3000 ? *((unsigned int*)structure_field[menu_pos]) += 1: *((unsigned int*)structure_field[menu_pos]) = 3000;
+          if (field <= FIELD_D)
+            *((unsigned int*)structure_field[field]) < top ? *((unsigned int*)structure_field[field]) += 1: *((unsigned int*)structure_field[field]) = top;
           else
-            if (menu_pos >= 3 && menu_pos < 5)
-              *((double*)structure_field[menu_pos]) < 50 ? *((double*)structure_field[menu_pos]) += 0.05: *((double*)structure_field[menu_pos]) = 50;
+            if (field <= FIELD_CORRECTION)
+              *((double*)structure_field[field]) < 50 ? *((double*)structure_field[field]) += 0.05: *((double*)structure_field[field]) = 50;
             else
-              *((byte*)structure_field[menu_pos]) < 90 ? *((byte*)structure_field[menu_pos]) += 1: *((byte*)structure_field[menu_pos]) = 90;  
+              *((byte*)structure_field[field]) < 90 ? *((byte*)structure_field[field]) += 1: *((byte*)structure_field[field]) = 90;  
         }
 
         if (enc1.isLeft())
         {
-          if (menu_pos >= 0 && menu_pos < 3)
-            *((unsigned int*)structure_field[menu_pos]) > 0 ? *((unsigned int*)structure_field[menu_pos]) -= 1: *((unsigned int*)structure_field[menu_pos]) = 0;
+          if (field <= FIELD_D)
+            *((unsigned int*)structure_field[field]) > 0 ? *((unsigned int*)structure_field[field]) -= 1: *((unsigned int*)structure_field[field]) = 0;
           else
-            if (menu_pos >= 3 && menu_pos < 5)
-              *((double*)structure_field[menu_pos]) > -50 ? *((double*)structure_field[menu_pos]) -= 0.05: *((double*)structure_field[menu_pos]) = -50;
+            if (field <= FIELD_CORRECTION)
+              *((double*)structure_field[field]) > -50 ? *((double*)structure_field[field]) -= 0.05: *((double*)structure_field[field]) = -50;
             else
-              *((byte*)structure_field[menu_pos]) > 1 ? *((byte*)structure_field[menu_pos]) -= 1: *((byte*)structure_field[menu_pos]) = 1;
+              *((byte*)structure_field[field]) > 1 ? *((byte*)structure_field[field]) -= 1: *((byte*)structure_field[field]) = 1;
         }
 
         if (enc1.isFastR())
         {
-          if (menu_pos >= 0 && menu_pos < 3)
-            *((unsigned int*)structure_field[menu_pos]) < 3000-3 ? *((unsigned int*)structure_field[menu_pos]) += 3: *((unsigned int*)structure_field[menu_pos]) = 3000;
+          if (field <= FIELD_D)
+            *((unsigned int*)structure_field[field]) < top-3 ? *((unsigned int*)structure_field[field]) += 3: *((unsigned int*)structure_field[field]) = top;
           else
-            if (menu_pos >= 3 && menu_pos < 5)
-              *((double*)structure_field[menu_pos]) < 50-0.05 ? *((double*)structure_field[menu_pos]) += 0.1: *((double*)structure_field[menu_pos]) = 50;
+            if (field <= FIELD_CORRECTION)
+              *((double*)structure_field[field]) < 50-0.05 ? *((double*)structure_field[field]) += 0.1: *((double*)structure_field[field]) = 50;
             else
-              *((byte*)structure_field[menu_pos]) < 90-3 ? *((byte*)structure_field[menu_pos]) += 3: *((byte*)structure_field[menu_pos]) = 90;
+              *((byte*)structure_field[field]) < 90-3 ? *((byte*)structure_field[field]) += 3: *((byte*)structure_field[field]) = 90;
         }
 
         if (enc1.isFastL())
         {
-          if (menu_pos >= 0 && menu_pos < 3)
-            *((unsigned int*)structure_field[menu_pos]) > 0+3 ? *((unsigned int*)structure_field[menu_pos]) -= 3: *((unsigned int*)structure_field[menu_pos]) = 0;
+          if (field <= FIELD_D)
+            *((unsigned int*)structure_field[field]) > 0+3 ? *((unsigned int*)structure_field[field]) -= 3: *((unsigned int*)structure_field[field]) = 0;
           else
-            if (menu_pos >= 3 && menu_pos < 5)
-              *((double*)structure_field[menu_pos]) > -50+3 ? *((double*)structure_field[menu_pos]) -= 0.1: *((double*)structure_field[menu_pos]) = -50;
+            if (field <= FIELD_CORRECTION)
+              *((double*)structure_field[field]) > -50+3 ? *((double*)structure_field[field]) -= 0.1: *((double*)structure_field[field]) = -50;
             else
-              *((byte*)structure_field[menu_pos]) > 1+3 ? *((byte*)structure_field[menu_pos]) -= 3: *((byte*)structure_field[menu_pos]) = 1;
+              *((byte*)structure_field[field]) > 1+3 ? *((byte*)structure_field[field]) -= 3: *((byte*)structure_field[field]) = 1;
         } 
       }
     }
     
-    if(Time > TimeSSD + 500)
+    if(Time - TimeSSD > 500)
     {
-      String str;
-      char tmpNum[7][6] = {};
+      char tmpNum[FIELDS + 1][6] = {}; //and the FIELD_TEST line
+      char tmpBand[4] = "g";
+      char tmpFrom[6] = "all";
 
-      //data preparation, conversion to Str
-      for(byte i = 0; i < 7; i++)
+      //data preparation
+      for(byte i = 0; i < FIELDS; i++)
       {
         switch (i) 
         {
-          case 0:
-            str = String(*((unsigned int*)structure_field[i])) + "ms";
-            break;
-          case 1:
-            str = String(*((unsigned int*)structure_field[i]));
+          case FIELD_PULSE:
+            fmtInt(tmpNum[i], 6, *((unsigned int*)structure_field[i]), "ms");
             break;
-          case 2:
-            str = String(*((unsigned int*)structure_field[i]));
+          case FIELD_P:
+          case FIELD_D:
+            fmtInt(tmpNum[i], 6, *((unsigned int*)structure_field[i]));
             break;
-          case 3:
-            str = String(*((double*)structure_field[i]));
+          case FIELD_I:
+            fmtFixed(tmpNum[i], 6, round(*((double*)structure_field[i])*100), 2);
             break;
-          case 4:
-            str = String(*((double*)structure_field[i])) + "C";
+          case FIELD_CORRECTION:
+            fmtFixed(tmpNum[i], 6, round(*((double*)structure_field[i])*100), 2, "C");
             break;
-          case 5:
-            str = String(*((byte*)structure_field[i])) + "C";
+          case FIELD_AMBIENT:
+            fmtInt(tmpNum[i], 6, *((byte*)structure_field[i]), "C");
             break;
-          case 6:
-            str = String(*((byte*)structure_field[i])) + "%";
+          case FIELD_ERROR_RATE:
+            fmtInt(tmpNum[i], 6, *((byte*)structure_field[i]), "%");
             break;
         }
-        str.toCharArray(tmpNum[i],6);
       }
+      if (menu_pos < MENU2_IDENT)
+        fmtInt(tmpNum[FIELD_TEST], 6, AUTOTUNE_SET, "C");
+      else
+        fmtInt(tmpNum[FIELD_TEST], 6, round(IDENT_DUTY*100), "%");
+      fmtInt(tmpBand+1, 3, band);
+      if (band != 0)
+      {
+        if (EEprom.Gain[band-1].from != 0)
+          fmtInt(tmpFrom, 6, EEprom.Gain[band-1].from, "C");
+        else
+          memcpy(tmpFrom, "off", 4);
+      }
+
+      //second page: the plate model, shown only, and its identification
+      char tmpModel[3][10];
+      fmtFixed(tmpModel[0], 10, round(EEprom.Model.rise*100), 2, "C/s");
+      fmtInt(tmpModel[1], 10, round(EEprom.Model.tau), "s");
+      fmtFixed(tmpModel[2], 10, round(EEprom.Model.lag*10), 1, "s");
 
       //output
       u8g2.firstPage();
+      if (menu_pos >= MENU2_IDENT)
+      {
+        do {
+          u8g2.setFontMode(1);
+          u8g2.setFont(u8g2_font_6x10_tf);
+          u8g2.setDrawColor(1);
+          u8g2.drawStr(2, 10, "Model");
+          u8g2.drawStr(4, 25, "rise");
+          u8g2.drawStr(4, 37, "tau");
+          u8g2.drawStr(4, 49, "lag");
+          u8g2.drawStr(4, 61, "id");
+          for(byte i = 0; i < 3; i++)
+            u8g2.drawStr(4+31, 25 + 12*i, tmpModel[i]);
+          u8g2.drawStr(4+31, 61, tmpNum[FIELD_TEST]);
+          u8g2.setDrawColor(2);
+          u8g2.drawBox(2, 52, 18, 11);
+        } while(u8g2.nextPage());
+        TimeSSD = millis();
+        continue;
+      }
       do {
         u8g2.setFontMode(1);
         u8g2.setFont(u8g2_font_6x10_tf);
         u8g2.setDrawColor(1);
         u8g2.drawStr(2, 10, "Setting");
+        u8g2.drawStr(4+25+22, 10, tmpBand);
+        u8g2.drawStr(66+25, 10, tmpFrom);
           
         u8g2.drawStr(4, 25, "Pu");
         u8g2.drawStr(4, 37, "P");
@@ -568,15 +1151,29 @@ void menu2()
         u8g2.drawStr(66, 25, "co");
         u8g2.drawStr(66, 37, "am");
         u8g2.drawStr(66, 49, "er");
+        u8g2.drawStr(66, 61, "tu");
 
-        for(byte i = 0; i < 7; i++)
+        for(byte i = 0; i <= FIELD_TEST; i++)
           if(i<4)
             u8g2.drawStr(4+25, 25 + 12*i, tmpNum[i]);
           else
             u8g2.drawStr(66+25, 25 + 12*(i-4), tmpNum[i]);
         
         u8g2.setDrawColor(2); 
-        u8g2.drawBox((menu_pos<4 ? 2 : 64) + (menu_edit == true ? 25:0), 16 + (menu_pos<4 ? menu_pos: menu_pos-4)*12 , 18+ (menu_edit == true ? 15:0), 11);
+        if (menu_pos < MENU2_FIELD) //title row, gain set and its start T: frame to move, filled to edit
+        {
+          byte boxX = menu_pos == 0 ? 2+25+22 : 64+25;
+          byte boxW = menu_pos == 0 ? 16 : 28;
+          if (menu_edit == true)
+            u8g2.drawBox(boxX, 1, boxW, 11);
+          else
+            u8g2.drawFrame(boxX, 1, boxW, 11);
+        }
+        else
+        {
+          byte field = menu_pos - MENU2_FIELD;
+          u8g2.drawBox((field<4 ? 2 : 64) + (menu_edit == true ? 25:0), 16 + (field<4 ? field: field-4)*12 , 18+ (menu_edit == true ? 15:0), 11);
+        }
       } while(u8g2.nextPage());
       
       TimeSSD = millis();
@@ -584,388 +1181,431 @@ void menu2()
   }
 }
 
-void setup() 
+/**
+ * @brief end of a profile run under ilc.h: learns from it, the run's error on Serial
+ * 
+ */
+void ilcDone()
 {
-  //EEPROM.update(0, 0); // overwriting default values
-  
-  getEEPROM();
-
-  Serial.begin(9600);
-  
-  BottomPID.SetOutputLimits(0, EEprom.Pulse); //regulation limit
-  BottomPID.SetMode(MANUAL); //PID to manual (stop)
-
-  Time = millis();
-  windowONTime = Time;
-  TimePID  = Time;
-  TimeCOM = Time;
-  TimeMAX = Time;
-  TimeProfile = Time;
-
-  pinMode(Pin_HOT, OUTPUT);
-  digitalWrite(Pin_HOT, 0);
-
-  pinMode(Pin_ENC_DT, INPUT);          
-  digitalWrite(Pin_ENC_DT, HIGH);//20k vcc
-  
-  pinMode(Pin_ENC_CLK, INPUT);          
-  digitalWrite(Pin_ENC_CLK, HIGH);//20k vcc
-  
-  pinMode(Pin_ENC_SW, INPUT);          
-  digitalWrite(Pin_ENC_SW, HIGH);//20k vcc
-
-  u8g2.begin();
-  delay(100);
-  u8g2.begin();
+  ilcEnd();
+  IlcRun = false;
+
+  const IlcStats &stats = ilcStats(EEprom.Mode);
+  char line[8];
+  Serial.print(F("ILC M"));
+  Serial.print(EEprom.Mode + 1);
+  Serial.print(F(" run "));
+  Serial.print(stats.runs);
+  fmtFixed(line, sizeof(line), stats.rms, 2, "C");
+  Serial.print(F(" rms "));
+  Serial.print(line);
+  if (stats.runs > 1)
+  {
+    fmtFixed(line, sizeof(line), stats.prev, 2, "C");
+    Serial.print(F(" was "));
+    Serial.print(line);
+  }
+  byte state = ilcState(EEprom.Mode);
+  Serial.print(state == ILC_SETTLED ? F(" settled\n") : (state == ILC_DIVERGING ? F(" diverging\n") : F(" learning\n")));
 }
 
-void loop() 
+/**
+ * @brief profile: next setpoint, stops the run at the end
+ * 
+ */
+void profileTask()
 {
-  Time = millis();
-  unsigned int Prof_Time_sec = (Time - TimeProfileStart)/1000;
+  if(on_off == false || TestRunning())
+    return;
 
-  //Profil
-  if (on_off == true && Time > TimeProfile + 1000) 
+  long temper;
+  byte phase;
+  if(profileSetpoint(Profile, Prof_Time_sec, temper, phase))
   {
-    if(EEprom.Mode < 3)
+    if(ProfilStatus < phase)
+      ProfilStatus = phase;
+    T_Set = (double)temper / (1L << PROFILE_Q);
+    double duty = 0;
+    if (FeedForward)
     {
-      if(Prof_Time_sec <= EEprom.TProfile[EEprom.Mode].timer_1)
-      {
-        if(ProfilStatus < 1)
-        ProfilStatus = 1;
-        T_Set = (double(EEprom.TProfile[EEprom.Mode].temper_1 - EEprom.T_Ambient)/(EEprom.TProfile[EEprom.Mode].timer_1))*Prof_Time_sec + EEprom.T_Ambient;
-      }
-      else
-        if(Prof_Time_sec <= EEprom.TProfile[EEprom.Mode].timer_1 + EEprom.TProfile[EEprom.Mode].timer_2)
-          {
-            if(ProfilStatus < 2)
-              ProfilStatus = 2;
-            T_Set = (double(EEprom.TProfile[EEprom.Mode].temper_2 - EEprom.TProfile[EEprom.Mode].temper_1)/(EEprom.TProfile[EEprom.Mode].timer_2))*(Prof_Time_sec - EEprom.TProfile[EEprom.Mode].timer_1) + EEprom.TProfile[EEprom.Mode].temper_1;
-          }
-        else
-          if(Prof_Time_sec <= EEprom.TProfile[EEprom.Mode].timer_1 + EEprom.TProfile[EEprom.Mode].timer_2 + EEprom.TProfile[EEprom.Mode].timer_3/2)
-            {
-              if(ProfilStatus < 3)
-              ProfilStatus = 3;
-              T_Set = (double(EEprom.TProfile[EEprom.Mode].temper_3 - EEprom.TProfile[EEprom.Mode].temper_2)/(EEprom.TProfile[EEprom.Mode].timer_3/2))*(Prof_Time_sec - EEprom.TProfile[EEprom.Mode].timer_1 - EEprom.TProfile[EEprom.Mode].timer_2) + EEprom.TProfile[EEprom.Mode].temper_2;
-            }
-          else
-              if(Prof_Time_sec <= EEprom.TProfile[EEprom.Mode].timer_1 + EEprom.TProfile[EEprom.Mode].timer_2 + EEprom.TProfile[EEprom.Mode].timer_3)
-                {
-                  if(ProfilStatus < 4)
-                    ProfilStatus = 4;
-                  T_Set = (double(EEprom.TProfile[EEprom.Mode].temper_2 - EEprom.TProfile[EEprom.Mode].temper_3)/(EEprom.TProfile[EEprom.Mode].timer_3/2))*(Prof_Time_sec - EEprom.TProfile[EEprom.Mode].timer_1 - EEprom.TProfile[EEprom.Mode].timer_2- EEprom.TProfile[EEprom.Mode].timer_3/2) + EEprom.TProfile[EEprom.Mode].temper_3;
-                }
-              else
-                if(Prof_Time_sec <= EEprom.TProfile[EEprom.Mode].timer_1 + EEprom.TProfile[EEprom.Mode].timer_2 + EEprom.TProfile[EEprom.Mode].timer_3 + EEprom.TProfile[EEprom.Mode].timer_4)
-                  {
-                    if(ProfilStatus < 5)
-                      ProfilStatus = 5;
-                    T_Set = (double(EEprom.TProfile[EEprom.Mode].temper_4 - EEprom.TProfile[EEprom.Mode].temper_2)/(EEprom.TProfile[EEprom.Mode].timer_4))*(Prof_Time_sec - EEprom.TProfile[EEprom.Mode].timer_1 - EEprom.TProfile[EEprom.Mode].timer_2 - EEprom.TProfile[EEprom.Mode].timer_3) + EEprom.TProfile[EEprom.Mode].temper_2;
-                  }
-                else
-                  StopHot();
+      //duty the plate model needs on this segment: its slope plus the loss at T_Set
+      const PlantModel &model = observerModel();
+      double slope = (double)profileSlope(Profile) / (1L << PROFILE_Q);
+      duty = (slope + (T_Set - EEprom.T_Ambient) / model.tau) / model.rise;
+      duty = duty < 0 ? 0 : (duty > 1 ? 1 : duty);
     }
-    else
+    if (IlcRun)
     {
-      if(Prof_Time_sec <= EEprom.Time_entry_manual)
-      {
-        T_Set = (double(EEprom.T_manual - EEprom.T_Ambient)/EEprom.Time_entry_manual)*Prof_Time_sec + EEprom.T_Ambient;
-      }
-      else
-        if(EEprom.Time_hold_manual != 0 && Prof_Time_sec > EEprom.Time_entry_manual + EEprom.Time_hold_manual)
-          StopHot();
-        else
-          T_Set = EEprom.T_manual;
+      //the plate's error, the PID runs on the estimate too; nothing to learn where the heater is already at the limit
+      double error = T_Set - observerTemper();
+      if (error > 0 ? OutBottom < EEprom.Pulse : OutBottom > 0)
+        ilcSample(Prof_Time_sec, error);
+      duty += ilcCorrection(Prof_Time_sec);
     }
-
-    TimeProfile = millis();
+    if (FeedForward || IlcRun)
+      FeedBottom = duty * EEprom.Pulse;
+    recorderSample(Prof_Time_sec, T_Bottom, T_Set, OutBottom);
   }
-  
-  //MAX
-  if (Time > TimeMAX + 500) 
+  else
   {
-    T_Bottom = temperature_bottom.readCelsius() + EEprom.thermocorrection;
+    if (IlcRun)
+      ilcDone();
+    StopHot();
+  }
+}
 
-    //thermocouple test
-    if(on_off == true)
+/**
+ * @brief MAX6675 read and thermocouple test
+ * 
+ */
+void sensorTask()
+{
+  unsigned long now = millis();
+  if (!sensorReady(now)) //the run came early, a read now would restart the conversion
+    return;
+  T_Bottom = sensorFilter(temperature_bottom.readCelsius(), now) + EEprom.thermocorrection;
+  observerUpdate(T_Bottom, on_off ? OutBottom / EEprom.Pulse : 0, EEprom.T_Ambient, now);
+
+  //thermocouple test, the autotune and the identification check the rise themselves
+  if(on_off == true && !TestRunning())
+  {
+    if(T_Set >= T_Bottom)
     {
-      if(T_Set >= T_Bottom)
+      if(ErrorRate_count <= 5)
       {
-        if(ErrorRate_count <= 5)
-        {
-          ErrorRate_buf = (ErrorRate_buf +(T_Bottom/T_Set)*100)/2;
-          ErrorRate_count++;
-        }
-        else 
+        ErrorRate_buf = (ErrorRate_buf +(T_Bottom/T_Set)*100)/2;
+        ErrorRate_count++;
+      }
+      else 
+      {
+        if(100 - ErrorRate_buf > EEprom.ErrorRate)
         {
-          if(100 - ErrorRate_buf > EEprom.ErrorRate)
+          char charVar[11];
+          byte len = fmtInt(charVar, sizeof(charVar), 100 - ErrorRate_buf, "% > ");
+          fmtInt(charVar + len, sizeof(charVar) - len, EEprom.ErrorRate, "%");
+          
+          StopHot();
+
+          u8g2.firstPage();
+          do {
+            u8g2.setFontMode(1);
+            u8g2.setFont(u8g2_font_6x10_tf);
+            u8g2.setDrawColor(1);
+            u8g2.drawStr(40, 10, "ERROR!!!");
+            u8g2.drawStr(19, 25, "NO Thermocouple");
+            u8g2.drawStr(37, 40, charVar);
+            u8g2.drawStr(52, 55, " OK ");
+            u8g2.setDrawColor(2); 
+            u8g2.drawBox(52, 47, 24, 10);
+          } while(u8g2.nextPage() );
+          Serial.print(F("ERROR "));
+          Serial.print(charVar);
+          Serial.print("\n");
+
+          while(true)
           {
-            String tmp = "";
-            tmp += String(100 - ErrorRate_buf);
-            tmp += "\% > ";
-            tmp += String(EEprom.ErrorRate);
-            tmp += "\%";
-            char charVar[11];
-            tmp.toCharArray(charVar, 11);
-            
-            StopHot();
-
-            u8g2.firstPage();
-            do {
-              u8g2.setFontMode(1);
-              u8g2.setFont(u8g2_font_6x10_tf);
-              u8g2.setDrawColor(1);
-              u8g2.drawStr(40, 10, "ERROR!!!");
-              u8g2.drawStr(19, 25, "NO Thermocouple");
-              u8g2.drawStr(37, 40, charVar);
-              u8g2.drawStr(52, 55, " OK ");
-              u8g2.setDrawColor(2); 
-              u8g2.drawBox(52, 47, 24, 10);
-            } while(u8g2.nextPage() );
-            Serial.print("ERROR ");
-            Serial.print(tmp);
-            Serial.print("\n");
-
-            while(true)
-            {
-              enc1.tick();
-              delay(200);
-              if (enc1.isHold())
-                break;
-            }
+            enc1.tick();
+            delay(200);
+            if (enc1.isHold())
+              break;
           }
-          ErrorRate_count = 0;
-          ErrorRate_buf = 0;
+          schedulerStart(Tasks, TASKS, millis());
+          displayRestart();
         }
-      }
-      else
-      {
         ErrorRate_count = 0;
         ErrorRate_buf = 0;
       }
     }
-
-    TimeMAX = millis();
+    else
+    {
+      ErrorRate_count = 0;
+      ErrorRate_buf = 0;
+    }
   }
+}
+
+/**
+ * @brief PID
+ * 
+ */
+void pidTask()
+{
+  if(on_off == false)
+    return;
 
-  //PID
-  if(on_off == true)
+  InputBottom = ObserverInput || IlcRun ? observerTemper() : T_Bottom; //ilc.h learns the plate, not the lagging sensor
+  if (autotuneState() == AUTOTUNE_RUNNING)
   {
-    if (Time > TimePID + 200) 
+    byte tune = autotuneStep(InputBottom, millis(), OutBottom);
+    ssrSet(OutBottom);
+    if (tune != AUTOTUNE_RUNNING)
+      tuneDone();
+    return;
+  }
+  if (identState() == IDENT_RUNNING)
+  {
+    byte ident = identStep(T_Bottom, millis(), OutBottom); //the sensor lag is part of the model
+    ssrSet(OutBottom);
+    if (ident != IDENT_RUNNING)
+      identDone();
+    return;
+  }
+  if (MpcRun)
+  {
+    double duty;
+    if (mpcStep(observerTemper(), Profile, Prof_Time_sec, millis(), duty))
     {
-      InputBottom = T_Bottom;
-      BottomPID.Compute();
-      TimePID = millis();
+      OutBottom = duty * EEprom.Pulse;
+      ssrSet(OutBottom);
     }
+    return;
+  }
+  gainSchedule();
+  if (BottomPID.Compute())
+    ssrSet(OutBottom);
+}
 
-    unsigned long Time_now = millis();
-    if (Time_now - windowONTime > EEprom.Pulse)
-      windowONTime += EEprom.Pulse;
+/**
+ * @brief time-proportioned heater output, every pass
+ * 
+ */
+void outputTask()
+{
+  if(on_off == false)
+    return;
 
-    if (OutBottom > (Time_now - windowONTime))
-      digitalWrite(Pin_HOT, 1);
-    else
-      digitalWrite(Pin_HOT, 0);
-  }
+  ssrUpdate();
+}
 
-/*  //UART
-  if (on_off == true && Time > TimeCOM + 1000) 
-  {
-    Serial.print("Mode: ");
-    Serial.print(EEprom.Mode);
-    Serial.print("\n");
+/**
+ * @brief draws the main screen into the current page
+ * 
+ */
+void drawScreen(const Screen &screen)
+{
+  const byte x0 =graphX0;
+  const byte y0 =graphY0;
+  const byte x1 =graphX1;
+  const byte y1 =graphY1;
+
+  u8g2.setFontMode(1);
+  u8g2.setFont(u8g2_font_6x10_tf);
+  u8g2.setDrawColor(1);
+  u8g2.drawStr(2, 62, " M1 ");
+  u8g2.drawStr(25+2, 62, " M2 ");
+  u8g2.drawStr(50+2, 62, " M3 ");
+  u8g2.drawStr(73, 62, " MAN ");
 
-    if(EEprom.Mode < 3)
-    {
-      Serial.print("ProfilStatus: ");
-      Serial.print(ProfilStatus);
-      Serial.print("\n");
-    }
-    else
-    {
-      Serial.print("Temperature MAX: ");
-      Serial.print(EEprom.T_manual);
-      Serial.print("\n");
-    }
-    
-    Serial.print("Temperature: ");
-    Serial.print(T_Bottom);
-    Serial.print("\n");
-    Serial.print("Temperature Set:  ");
-    Serial.print(T_Set);
-    Serial.print("\n");
-    Serial.print("Pulse Out:  ");
-    Serial.print(OutBottom);
-    Serial.print("\n");
-    Serial.print("Time:  ");
-    Serial.print(Prof_Time_sec);
-    Serial.print("\n");
-    Serial.print("\n");
+  
+  u8g2.drawStr(2, 10, "T:");
+  u8g2.drawStr(13+2, 10,  screen.text[2]);
+  
+  if(screen.mode == 3)
+  {
+    u8g2.drawStr(2, 20, "S:");
+    u8g2.drawStr(13+2, 20,  screen.text[1]);
 
-    TimeCOM = millis();
-  }
-*/
-
-  //display
-  if (Time > TimeSSD + (on_off == true ? 500 : 100)) 
-  {
-    //preliminary calculation of the scale of the schedule
-    const byte x0 =44;
-    const byte y0 =52;
-    const byte x1 =120;
-    const byte y1 =2;
-    double scaleX = 0;
-    double scaleY = 0;
-    void* structure_field[8] = {&EEprom.TProfile[EEprom.Mode].temper_1, 
-                                &EEprom.TProfile[EEprom.Mode].temper_2, 
-                                &EEprom.TProfile[EEprom.Mode].temper_3,
-                                &EEprom.TProfile[EEprom.Mode].temper_4, 
-                                &EEprom.TProfile[EEprom.Mode].timer_1,
-                                &EEprom.TProfile[EEprom.Mode].timer_2, 
-                                &EEprom.TProfile[EEprom.Mode].timer_3,
-                                &EEprom.TProfile[EEprom.Mode].timer_4};
-
-    if(EEprom.Mode <3)
-    {
-      for (byte i = 4; i < 8; i++)
-        scaleX += *((unsigned int*)structure_field[i]);
-      scaleX = scaleX/(x1-x0);
-      
-      for (byte i = 0; i < 4; i++)
-        if(scaleY < *((int*)structure_field[i]))
-          scaleY = *((int*)structure_field[i]);
-      scaleY = scaleY/(y0-y1);
-    }
+    u8g2.drawStr(2, 30, "M:");
+    u8g2.drawStr(13+2, 30,  screen.text[3]);
 
-    const void* SSD_field[5] = {&ProfilStatus, 
-                                &T_Set, 
-                                &T_Bottom,
-                                &EEprom.T_manual, 
-                                &Prof_Time_sec};
+  }
+  else
+  {
+    u8g2.drawStr(2, 20, "S:");
+    u8g2.drawStr(13+2, 20,  screen.text[1]);
+    u8g2.drawStr(2, 30, "P:");
+    u8g2.drawStr(13+2, 30,  screen.text[0]);
+  }
 
-    //data preparation, conversion to Str
-    String str;
-    char tmpSSD[5][5] = {};
-    for(byte i = 0; i < 5; i++)
-    {
-      if(i == 0)
-        str = String(*((byte*)SSD_field[i]));
-      else
-        if(i == 4)
-          str = String(*((unsigned int*)SSD_field[i])) + "s";
-        else
-          if(i == 3)
-            str = String(round(*((int*)SSD_field[i]))) + "C";
-          else
-            str = String(round(*((double*)SSD_field[i]))) + "C";
-          
-      str.toCharArray(tmpSSD[i],5);
-    }
+  u8g2.setDrawColor(2); 
+  u8g2.drawBox(2+(screen.mode*25), 54, 22, 11);
+  
 
-    //output
-    u8g2.firstPage();
-    do {
-      u8g2.setFontMode(1);
-      u8g2.setFont(u8g2_font_6x10_tf);
-      u8g2.setDrawColor(1);
-      u8g2.drawStr(2, 62, " M1 ");
-      u8g2.drawStr(25+2, 62, " M2 ");
-      u8g2.drawStr(50+2, 62, " M3 ");
-      u8g2.drawStr(73, 62, " MAN ");
+  if(screen.on == true)
+  {
+    u8g2.drawStr(2, 40, "t:");
+    u8g2.drawStr(13+2, 40,  screen.text[4]);
 
-      
-      u8g2.drawStr(2, 10, "T:");
-      u8g2.drawStr(13+2, 10,  tmpSSD[2]);
-      
-      if(EEprom.Mode == 3)
-      {
-        u8g2.drawStr(2, 20, "S:");
-        u8g2.drawStr(13+2, 20,  tmpSSD[1]);
+    u8g2.setFont(u8g2_font_6x10_tf);//u8g2_font_unifont_t_symbols
+    u8g2.drawUTF8(110, 62, "ON");//"☕"
+  }
+  else if(screen.learn != ILC_NONE) //rms error of the last ILC run, "e=" once it stops dropping, "e!" when it rose
+  {
+    u8g2.drawStr(2, 40, screen.learn == ILC_SETTLED ? "e=" : (screen.learn == ILC_DIVERGING ? "e!" : "e:"));
+    u8g2.drawStr(13+2, 40,  screen.text[4]);
+  }
 
-        u8g2.drawStr(2, 30, "M:");
-        u8g2.drawStr(13+2, 30,  tmpSSD[3]);
+  //plotting
+  if(screen.mode < 3)
+  {
+    u8g2.drawLine(x0, y0, x0, y1);
+    u8g2.drawLine(x0, y0, x1, y0);
 
-      }
-      else
-      {
-        u8g2.drawStr(2, 20, "S:");
-        u8g2.drawStr(13+2, 20,  tmpSSD[1]);
-        u8g2.drawStr(2, 30, "P:");
-        u8g2.drawStr(13+2, 30,  tmpSSD[0]);
-      }
+    for (byte i = 1; i < ProfileGraph.count; i++)
+      u8g2.drawLine(ProfileGraph.x[i-1], ProfileGraph.y[i-1], ProfileGraph.x[i], ProfileGraph.y[i]);
 
-      u8g2.setDrawColor(2); 
-      u8g2.drawBox(2+(EEprom.Mode*25), 54, 22, 11);
-      
+    if(screen.cursor != 0)
+      u8g2.drawLine(screen.cursor, y0, screen.cursor, y1);
+  }
+}
 
-      if(on_off == true)
-      {
-        u8g2.drawStr(2, 40, "t:");
-        u8g2.drawStr(13+2, 40,  tmpSSD[4]);
+/**
+ * @brief profile polyline in pixels, scaled to the graph area
+ * 
+ */
+void buildGraph(byte mode)
+{
+  const ProfileS &profile = EEprom.TProfile[mode];
+  unsigned int total = 0;
+  int top = 0;
+  for (byte i = 0; i < profile.count; i++)
+  {
+    total += profile.point[i].time;
+    if(top < profile.point[i].temper)
+      top = profile.point[i].temper;
+  }
 
-        u8g2.setFont(u8g2_font_6x10_tf);//u8g2_font_unifont_t_symbols
-        u8g2.drawUTF8(110, 62, "ON");//"☕"
-      }
+  ProfileGraph.mode = mode;
+  ProfileGraph.total = total;
+  ProfileGraph.count = 0;
+  if(total == 0 || top == 0)
+    return;
+
+  double scaleX = (double)total/(graphX1-graphX0);
+  double scaleY = (double)top/(graphY0-graphY1);
+  unsigned int tmpGraph = 0;
+  int tmpTemper = EEprom.T_Ambient;
+  byte n = 0;
+
+  ProfileGraph.x[n] = graphX0;
+  ProfileGraph.y[n++] = graphY0 - round(tmpTemper/scaleY);
+  for (byte i = 0; i < profile.count; i++)
+  {
+    const ProfilePoint &point = profile.point[i];
+    if (point.step)
+    {
+      ProfileGraph.x[n] = graphX0 + round(tmpGraph/scaleX);
+      ProfileGraph.y[n++] = graphY0 - round(point.temper/scaleY);
+    }
+    tmpGraph += point.time;
+    tmpTemper = point.temper;
+    ProfileGraph.x[n] = graphX0 + round(tmpGraph/scaleX);
+    ProfileGraph.y[n++] = graphY0 - round(tmpTemper/scaleY);
+  }
+  ProfileGraph.count = n;
+}
 
-      //plotting
-      if(EEprom.Mode < 3)
-      {
-        u8g2.drawLine(x0, y0, x0, y1);
-        u8g2.drawLine(x0, y0, x1, y0);
-
-        unsigned int tmpGraph = *((unsigned int*)structure_field[4]);
-        u8g2.drawLine(x0, 
-                      y0 - round(EEprom.T_Ambient/scaleY), 
-                      x0 + round(tmpGraph/scaleX), 
-                      y0 - round(*((int*)structure_field[0])/scaleY));
-        
-      
-        u8g2.drawLine(x0 + round(*((unsigned int*)structure_field[4])/scaleX), 
-                      y0 - round(*((int*)structure_field[0])/scaleY), 
-                      x0 + round((tmpGraph + *((unsigned int*)structure_field[5]))/scaleX), 
-                      y0 - round(*((int*)structure_field[1])/scaleY));
-
-        tmpGraph += *((unsigned int*)structure_field[5]);
-        u8g2.drawLine(x0 + round(tmpGraph/scaleX), 
-                      y0 - round(*((int*)structure_field[1])/scaleY), 
-                      x0 + round((tmpGraph+*((unsigned int*)structure_field[6])/2)/scaleX), 
-                      y0 - round(*((int*)structure_field[2])/scaleY));
-        
-        u8g2.drawLine(x0 + round((tmpGraph+*((unsigned int*)structure_field[6])/2)/scaleX), 
-                      y0 - round(*((int*)structure_field[2])/scaleY), 
-                      x0 + round((tmpGraph+*((unsigned int*)structure_field[6]))/scaleX), 
-                      y0 - round(*((int*)structure_field[1])/scaleY));
-        
-        
-        tmpGraph += *((unsigned int*)structure_field[6]);
-        u8g2.drawLine(x0 + round(tmpGraph/scaleX), 
-                      y0 - round(*((int*)structure_field[1])/scaleY), 
-                      x0 + round((tmpGraph+*((unsigned int*)structure_field[7]))/scaleX), 
-                      y0 - round(*((int*)structure_field[3])/scaleY));
-
-        if(on_off == true)
-          u8g2.drawLine(x0 + round(*((unsigned int*)SSD_field[4])/scaleX), 
-                        y0, 
-                        x0 + round(*((unsigned int*)SSD_field[4])/scaleX), 
-                        y1);
-      }
-    }while(u8g2.nextPage());
+/**
+ * @brief main screen: prepares a frame, skipped when nothing visible changed;
+ * the pages are sent by pageTask()
+ * 
+ */
+void displayTask()
+{
+  if (framePending)
+    return;
+
+  //data preparation
+  Screen screen = {};
+  fmtInt(screen.text[0], 5, ProfilStatus);
+  fmtTemper(screen.text[1], 5, T_Set);
+  fmtTemper(screen.text[2], 5, T_Bottom);
+  fmtInt(screen.text[3], 5, EEprom.T_manual, "C");
+  fmtInt(screen.text[4], 5, Prof_Time_sec, "s");
+  screen.mode = EEprom.Mode;
+  screen.on = on_off;
+  if (!on_off && profileControl(screen.mode) == CONTROL_PID_ILC && ilcStats(screen.mode).runs != 0)
+  {
+    fmtFixed(screen.text[4], 5, ilcStats(screen.mode).rms / 10, 1);
+    screen.learn = ilcState(screen.mode);
+  }
+  if(screen.mode < 3)
+  {
+    if(ProfileGraph.mode != screen.mode)
+      buildGraph(screen.mode);
+    if(on_off == true && ProfileGraph.total != 0)
+    {
+      unsigned long t = Prof_Time_sec < ProfileGraph.total ? Prof_Time_sec : ProfileGraph.total;
+      screen.cursor = graphX0 + (t*(graphX1-graphX0) + ProfileGraph.total/2)/ProfileGraph.total;
+    }
+  }
 
-    TimeSSD = millis();
+  if (screenValid && memcmp(&screen, &ScreenShown, sizeof(Screen)) == 0)
+  {
+    DisplayStat.skipped++;
+    return;
   }
 
-  //encoder
+  ScreenNext = screen;
+  framePending = true;
+  frameStart = micros();
+  u8g2.firstPage();
+}
+
+/**
+ * @brief sends one page of the pending frame, every pass
+ * 
+ */
+void pageTask()
+{
+  if (!framePending)
+    return;
+
+  unsigned long pageStart = micros();
+  drawScreen(ScreenNext);
+  bool more = u8g2.nextPage();
+
+  unsigned long now = micros();
+  if (now - pageStart > DisplayStat.pageMax)
+    DisplayStat.pageMax = now - pageStart;
+  if (more)
+    return;
+
+  framePending = false;
+  ScreenShown = ScreenNext;
+  screenValid = true;
+  DisplayStat.frames++;
+  DisplayStat.frameLast = now - frameStart;
+  if (DisplayStat.frameLast > DisplayStat.frameMax)
+    DisplayStat.frameMax = DisplayStat.frameLast;
+}
+
+/**
+ * @brief drops a pending frame and forces a redraw,
+ * for code that draws the whole screen itself
+ * 
+ */
+void displayRestart()
+{
+  framePending = false;
+  screenValid = false;
+  ProfileGraph.mode = GRAPH_NONE;
+}
+
+/**
+ * @brief encoder, every pass
+ * 
+ */
+void encoderTask()
+{
   enc1.tick();
   if (enc1.isTurn()) 
   {
     if(on_off == false)
     {
       if (enc1.isRightH())
+      {
         menu2();
+        schedulerStart(Tasks, TASKS, millis());
+        displayRestart();
+      }
 
       if (enc1.isLeftH())
+      {
         menu1();
+        schedulerStart(Tasks, TASKS, millis());
+        displayRestart();
+      }
 
       if (enc1.isRight()) 
         EEprom.Mode >= 3 ? EEprom.Mode = 3: EEprom.Mode++; 
@@ -988,6 +1628,8 @@ void loop()
         else
           if (enc1.isFastL()) 
             EEprom.T_manual > EEprom.T_Ambient+3 ? EEprom.T_manual -=3: EEprom.T_manual = EEprom.T_Ambient;
+
+        compileProfile();
       }
     }
   }
@@ -1002,4 +1644,257 @@ void loop()
       RunHot(EEprom.Mode);
     }
   }
-}
\ No newline at end of file
+}
+
+//priority order, see scheduler.h
+#ifdef LOOP_STATS
+const char *const TaskNames[TASKS] = {"output", "pid", "sensor", "profile", "telemetry", "display", "page", "encoder", "serial"};
+
+/**
+ * @brief one line: runs, min/mean/max us, histogram
+ * 
+ */
+void printTime(const char *name, const TaskTime &time)
+{
+  Serial.print(name);
+  Serial.print(F(" n "));
+  Serial.print(time.count);
+  Serial.print(F(" min "));
+  Serial.print(time.min);
+  Serial.print(F(" mean "));
+  Serial.print(timeMean(time));
+  Serial.print(F(" max "));
+  Serial.print(time.max);
+  Serial.print(F(" us |"));
+  for (byte i = 0; i < TASK_HIST; i++)
+  {
+    Serial.print(" ");
+    Serial.print(time.hist[i]);
+  }
+  Serial.print("\n");
+}
+
+/**
+ * @brief one line: main screen frames sent and skipped, frame and page us
+ * 
+ */
+void printDisplay()
+{
+  Serial.print(F("screen n "));
+  Serial.print(DisplayStat.frames);
+  Serial.print(F(" skipped "));
+  Serial.print(DisplayStat.skipped);
+  Serial.print(F(" frame "));
+  Serial.print(DisplayStat.frameLast);
+  Serial.print(F(" max "));
+  Serial.print(DisplayStat.frameMax);
+  Serial.print(F(" page max "));
+  Serial.print(DisplayStat.pageMax);
+  Serial.print(F(" us\n"));
+}
+#endif
+
+/**
+ * @brief one line: sensor reads, rejected reads, noise in C
+ * 
+ */
+void printSensor()
+{
+  const SensorStats &stats = sensorStats();
+  Serial.print(F("sensor n "));
+  Serial.print(stats.reads);
+  Serial.print(F(" early "));
+  Serial.print(stats.early);
+  Serial.print(F(" glitch "));
+  Serial.print(stats.glitches);
+  Serial.print(F(" open "));
+  Serial.print(stats.open);
+  Serial.print(F(" noise "));
+  Serial.print(stats.noise / 64.0, 3);
+  Serial.print(F(" max "));
+  Serial.print(stats.noiseMax / 64.0, 3);
+  Serial.print(F(" C\n"));
+}
+
+/**
+ * @brief serial commands: tN - telemetry every N-th PID period (0 - off),
+ * o1/o0 - PID input from the observer / from the sensor (o0 also turns f off),
+ * f1/f0 - profile feed-forward on (with o1) / off,
+ * a - autotune, i - plant identification (y - store the result), c - clear the ILC tables,
+ * d - run recorder dump, n - sensor noise, l - loop latency per task and main screen frame times,
+ * r - reset the noise, latency and frame times
+ * 
+ */
+void serialTask()
+{
+  static char command = 0; //waiting for the argument
+
+  while (Serial.available() > 0)
+  {
+    char c = Serial.read();
+    if (command == 't')
+    {
+      if (c >= '0' && c <= '9')
+        telemetrySetDivider(c - '0');
+      command = 0;
+      continue;
+    }
+    if (command == 'o')
+    {
+      if (c == '0' || c == '1')
+      {
+        ObserverInput = c == '1';
+        if (!ObserverInput && FeedForward) //needs the estimate, see "f"
+        {
+          FeedForward = false;
+          FeedBottom = 0;
+        }
+      }
+      command = 0;
+      continue;
+    }
+    if (command == 'f')
+    {
+      if (c == '0' || c == '1')
+      {
+        //the model's duty moves the plate: on T_Bottom the PID would hold the lagging sensor to the ramp
+        FeedForward = c == '1';
+        if (FeedForward)
+          ObserverInput = true;
+        FeedBottom = 0;
+      }
+      command = 0;
+      continue;
+    }
+
+    switch (c)
+    {
+      case 't':
+      case 'o':
+      case 'f':
+        command = c;
+        break;
+      case 'n':
+        printSensor();
+        break;
+      case 'a':
+        if (on_off == false)
+        {
+          TuneSerial = true;
+          TuneHot();
+        }
+        break;
+      case 'i':
+        if (on_off == false)
+        {
+          TuneSerial = true;
+          IdentHot();
+        }
+        break;
+      case 'y':
+        if (autotuneState() == AUTOTUNE_DONE)
+          tuneAccept();
+        if (identState() == IDENT_DONE)
+          identAccept();
+        break;
+      case 'c':
+        for (byte i = 0; i < 3; i++)
+          ilcReset(i);
+        break;
+      case 'd':
+        recorderDump();
+        break;
+#ifdef LOOP_STATS
+      case 'l':
+        for (byte i = 0; i < TASKS; i++)
+          printTime(TaskNames[i], Tasks[i].time);
+        printTime("loop", LoopPeriod);
+        printDisplay();
+        break;
+#endif
+      case 'r':
+        sensorResetStats();
+#ifdef LOOP_STATS
+        schedulerResetTimes(Tasks, TASKS);
+#endif
+        memset(&DisplayStat, 0, sizeof(DisplayStat));
+        break;
+      default:
+        break;
+    }
+  }
+
+  recorderDumpNext();
+}
+
+Task Tasks[TASKS] = {
+  //   run           period ms  deadline ms
+  TASK(outputTask,    0,    0),
+  TASK(pidTask,       PID_TASK, 50),
+  TASK(sensorTask,    250,  100), //MAX6675 conversion is up to 220 ms
+  TASK(profileTask,   1000, 100),
+  TASK(telemetryTask, 200,  100),
+  TASK(displayTask,   100,  250), //500 while heating
+  TASK(pageTask,      0,    0),
+  TASK(encoderTask,   0,    0),
+  TASK(serialTask,    100,  500),
+};
+
+void setup() 
+{
+  //EEPROM.update(0, 0); // overwriting default values
+  
+  getEEPROM();
+  recorderBegin();
+
+  Serial.begin(9600);
+
+#if defined(PID_BENCH) && defined(__AVR__)
+  benchPaint();
+  benchPID();
+  benchMPC();
+  benchRAM();
+#endif
+  
+  BottomPID.SetOutputLimits(0, EEprom.Pulse); //regulation limit
+  BottomPID.SetFeedForward(&FeedBottom);
+  BottomPID.SetMode(MANUAL); //PID to manual (stop)
+
+  Time = millis();
+  schedulerStart(Tasks, TASKS, Time);
+
+  pinMode(Pin_HOT, OUTPUT);
+  digitalWrite(Pin_HOT, 0);
+
+  pinMode(Pin_ENC_DT, INPUT);          
+  digitalWrite(Pin_ENC_DT, HIGH);//20k vcc
+  
+  pinMode(Pin_ENC_CLK, INPUT);          
+  digitalWrite(Pin_ENC_CLK, HIGH);//20k vcc
+  
+  pinMode(Pin_ENC_SW, INPUT);          
+  digitalWrite(Pin_ENC_SW, HIGH);//20k vcc
+
+  enc1.setInterrupt(true);
+  enc1.setAcceleration(EncAccel, sizeof(EncAccel)/sizeof(EncAccel[0]));
+#ifdef __AVR__
+  *digitalPinToPCMSK(Pin_ENC_CLK) |= bit(digitalPinToPCMSKbit(Pin_ENC_CLK));
+  *digitalPinToPCMSK(Pin_ENC_DT) |= bit(digitalPinToPCMSKbit(Pin_ENC_DT));
+  PCICR |= bit(digitalPinToPCICRbit(Pin_ENC_CLK));
+#else
+  attachInterrupt(digitalPinToInterrupt(Pin_ENC_CLK), encoderISR, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(Pin_ENC_DT), encoderISR, CHANGE);
+#endif
+
+  u8g2.begin();
+  delay(100);
+  u8g2.begin();
+}
+
+void loop() 
+{
+  Time = millis();
+  Prof_Time_sec = (Time - TimeProfileStart)/1000;
+
+  schedulerRun(Tasks, TASKS, Time);
+}
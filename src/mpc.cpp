@@ -0,0 +1,99 @@
+#include "mpc.h"
+#include <PID_fixed.h>
+
+typedef PIDFixed<16> Fixed; //its saturating 32-bit add() and mul(): int64_t is a libgcc call on AVR
+
+#define Q 16
+#define ONE (1L << Q)
+#define GAIN_Q 24 //c_k
+
+static long ambientQ;         //C, Q16.16
+static long a[MPC_POINTS];    //free response decay, Q16
+static long c[MPC_POINTS];    //least squares gains, 1/C, Q8.24
+static long loss1, g1;        //one MPC_PERIOD: 1 - decay Q8.24 (a Q16 decay is 1e-3 C off a step, which d would learn), C per duty Q16.16
+static long biasGain;         //MPC_BIAS / g1, duty per C, Q8.24
+static long bias;             //d, duty Q7.24: the truncated products do not pile up in it
+static long lastT, lastU;     //T - ambient and u + d of the last step, Q16.16
+static bool started;
+static unsigned long last;
+
+static long toQ(double v)
+{
+  return (long)(v * ONE + (v >= 0 ? 0.5 : -0.5));
+}
+
+/**
+ * @brief works out the prediction from the plant model, next step starts afresh
+ */
+void mpcStart(const PlantModel &model, double ambient, unsigned long now)
+{
+  double tau = model.tau > 2 ? model.tau : 2; //loss1 * T fits Q7.24 up to 300 C over ambient
+  double g[MPC_POINTS], gg = 0;
+  for (byte k = 0; k < MPC_POINTS; k++)
+  {
+    double decay = exp(-(double)MPC_STEP * (k + 1) / tau);
+    a[k] = toQ(decay);
+    g[k] = model.rise * tau * (1 - decay);
+    gg += g[k] * g[k];
+  }
+  for (byte k = 0; k < MPC_POINTS; k++)
+    c[k] = gg > 0 ? (long)(g[k] / gg * (1L << GAIN_Q) + 0.5) : 0;
+
+  double decay = exp(-MPC_PERIOD / 1000.0 / tau);
+  double step = model.rise * tau * (1 - decay);
+  loss1 = (long)((1 - decay) * (1L << GAIN_Q) + 0.5);
+  g1 = toQ(step);
+  biasGain = step > 0 ? (long)(MPC_BIAS / step * (1L << GAIN_Q) + 0.5) : 0;
+
+  ambientQ = toQ(ambient);
+  bias = 0;
+  started = false;
+  last = now - MPC_PERIOD;
+}
+
+/**
+ * @brief next duty every MPC_PERIOD
+ *
+ * @param plate - estimated plate temperature now, C
+ * @param time - s from run start, T_Set is read ahead from here
+ * @param duty - 0..1
+ * @return false - not time yet, duty untouched
+ */
+bool mpcStep(double plate, const ProfileTable &profile, unsigned int time, unsigned long now, double &duty)
+{
+  if (now - last < MPC_PERIOD)
+    return false;
+  last = now;
+
+  long T = toQ(plate) - ambientQ;
+
+  //what the last duty should have done against what happened
+  if (started)
+  {
+    long predicted = lastT - (Fixed::mul(lastT, loss1) >> (GAIN_Q - Q)) + Fixed::mul(g1, lastU);
+    bias += Fixed::mul(T - predicted, biasGain);
+    bias = bias > (1L << GAIN_Q) ? (1L << GAIN_Q) : (bias < -(1L << GAIN_Q) ? -(1L << GAIN_Q) : bias);
+  }
+
+  long sum = 0; //duty, Q7.24: a product of c_k keeps its 24 fraction bits
+  for (byte k = 0; k < MPC_POINTS; k++)
+  {
+    long r = profilePeek(profile, time + MPC_STEP * (k + 1)) - ambientQ;
+    long free = Fixed::mul(T, a[k]);
+    sum = Fixed::add(sum, Fixed::mul(c[k], r - free));
+  }
+  long d = bias >> (GAIN_Q - Q);
+  long u = (sum >> (GAIN_Q - Q)) - d;
+  u = u > ONE ? ONE : (u < 0 ? 0 : u);
+
+  lastT = T;
+  lastU = u + d;
+  started = true;
+  duty = (double)u / ONE;
+  return true;
+}
+
+double mpcBias()
+{
+  return (double)bias / (1L << GAIN_Q);
+}
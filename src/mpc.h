@@ -0,0 +1,47 @@
+#ifndef IHC_MPC_h
+#define IHC_MPC_h
+
+#include <Arduino.h>
+#include "observer.h"
+#include "profile.h"
+
+/*
+	Model predictive control of the plate, instead of BottomPID for the
+	profiles that select it (profile screen, `pid`/`mpc`). Every MPC_PERIOD
+	the plate is predicted MPC_POINTS * MPC_STEP seconds ahead from the
+	observer's estimate with the observer's model: the sensor lag is what
+	the observer takes out, so the prediction is first order. The duty,
+	held over the horizon, that puts the prediction closest to the
+	profile's T_Set at those points (least squares) is clamped to 0..1:
+
+	  y_k = ambient + (T - ambient) a_k + g_k (u + d)
+	  a_k = exp(-t_k / tau),  g_k = rise tau (1 - a_k)
+	  u = sum c_k (r_k - ambient - (T - ambient) a_k) - d,  c_k = g_k / sum g_j^2
+
+	With one free move the clamp is the exact constrained optimum. The
+	controller sees the profile turn down before the sensor does and backs
+	off ahead of the peak. d is the duty the model is off by, learned from
+	the one-step prediction error (MPC_BIAS of it a step), so a wrong rise
+	or loss gives no steady offset.
+
+	a_k and c_k are worked out in mpcStart() in floating point; a step is
+	Q16.16 with the 32-bit saturating products of PIDFixed:
+	MPC_POINTS profilePeek() lookups and 2 * MPC_POINTS + 3 multiplies,
+	once a second. A -DPID_BENCH build prints its cycle count at startup;
+	the host time is `--bench mpc`.
+*/
+
+#define MPC_PERIOD 1000 //ms
+#ifndef MPC_STEP
+#define MPC_STEP   3    //s between prediction points
+#endif
+#ifndef MPC_POINTS
+#define MPC_POINTS 5    //horizon MPC_POINTS * MPC_STEP
+#endif
+#define MPC_BIAS   0.1  //share of the prediction error taken into d a step
+
+void mpcStart(const PlantModel &model, double ambient, unsigned long now);
+bool mpcStep(double plate, const ProfileTable &profile, unsigned int time, unsigned long now, double &duty);
+double mpcBias(); //d, duty
+
+#endif
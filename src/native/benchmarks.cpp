@@ -0,0 +1,406 @@
+/*
+	Host benchmarks for the native runner (--bench NAME). Host timings are
+	only comparable with each other; target numbers come from the same
+	code paths built with -DPID_BENCH for the AVR (see src/bench.cpp).
+	A benchmark that also checks a result makes the runner exit with 1
+	when the check fails.
+*/
+
+#include <NativeHAL.h>
+#include <PID_my.h>
+#include <PID_fixed.h>
+#include <PID_v2.h>
+#include <GyverEncoder.h>
+#include <stdio.h>
+#include <chrono>
+#include "benchmarks.h"
+#include "../format.h"
+#include "../mpc.h"
+#include "../ilc.h"
+
+typedef std::chrono::steady_clock bench_clock;
+
+static uint64_t elapsedNs(bench_clock::time_point t0)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - t0).count();
+}
+
+/**
+ * @brief PID vs PIDFixed<16> on the same input, IHC gains and limits;
+ * PIDv2 is a different control law, so only its time is compared;
+ * fails past the documented tolerance or when a product past the fixed
+ * range wraps instead of saturating
+ */
+static bool benchPID()
+{
+	const uint32_t N = 200000;
+	double input = 25, setpoint = 25, out_d = 0, out_f = 0, out_2 = 0;
+	PID pid_d(&input, &out_d, &setpoint, 50, 0.1, 20, DIRECT);
+	PIDFixed<16> pid_f(&input, &out_f, &setpoint, 50, 0.1, 20, DIRECT);
+	PIDv2 pid_2(&input, &out_2, &setpoint, 50, 0.1, 20, DIRECT);
+	pid_d.SetOutputLimits(0, 500);
+	pid_f.SetOutputLimits(0, 500);
+	pid_2.SetOutputLimits(0, 500);
+	pid_d.SetMode(AUTOMATIC);
+	pid_f.SetMode(AUTOMATIC);
+	pid_2.SetMode(AUTOMATIC);
+
+	uint64_t ns_d = 0, ns_f = 0, ns_2 = 0;
+	double max_diff = 0, sum_diff = 0;
+	uint32_t seed = 1;
+
+	for (uint32_t i = 0; i < N; i++)
+	{
+		halAdvanceMicros(200000 + (i % 7) * 1000);
+
+		// profile-like setpoint, input lagging it with 0.25 C steps and noise
+		double t = (i % 1650) * 0.2;
+		setpoint = t < 120 ? 25 + t : (t < 210 ? 145 + (t - 120) * 0.6 : 200 - (t - 210) * 0.4);
+		seed = seed * 1103515245UL + 12345UL;
+		input = floor((setpoint - 5 + ((seed >> 16) % 100) / 20.0) * 4) / 4;
+
+		bench_clock::time_point t0 = bench_clock::now();
+		pid_d.Compute();
+		ns_d += elapsedNs(t0);
+
+		t0 = bench_clock::now();
+		pid_f.Compute();
+		ns_f += elapsedNs(t0);
+
+		t0 = bench_clock::now();
+		pid_2.Compute();
+		ns_2 += elapsedNs(t0);
+
+		double diff = fabs(out_d - out_f);
+		sum_diff += diff;
+		if (diff > max_diff) max_diff = diff;
+	}
+
+	printf("PID::Compute           %6.1f ns\n", (double)ns_d / N);
+	printf("PIDFixed<16>::Compute  %6.1f ns\n", (double)ns_f / N);
+	printf("PIDv2::Compute         %6.1f ns\n", (double)ns_2 / N);
+	printf("output difference      max %.4f, mean %.5f (output range 0-500)\n", max_diff, sum_diff / N);
+
+	// kp*error and kd*dErr far past 2^15: must clamp to the limits, both ways
+	bool saturates = true;
+	pid_f.SetTunings(30000, 0.1, 8000);
+	const double edge[4] = {16000, -16000, 16000, 0};
+	for (byte i = 0; i < 4; i++)
+	{
+		halAdvanceMicros(250000);
+		setpoint = edge[i];
+		input = 0;
+		pid_f.Compute();
+		if (out_f != (edge[i] > 0 ? 500 : 0))
+			saturates = false;
+	}
+	printf("PIDFixed<16> saturation %s\n", saturates ? "ok" : "WRAPPED");
+	return max_diff < 0.2 && saturates;
+}
+
+/**
+ * @brief main screen and settings fields: String + toCharArray vs format.h
+ */
+static bool benchFormat()
+{
+	const uint32_t N = 100000;
+	char s_text[7][6], f_text[7][6];
+	uint64_t ns_s = 0, ns_f = 0;
+	uint32_t mismatches = 0;
+
+	for (uint32_t i = 0; i < N; i++)
+	{
+		byte status = i % 6;
+		double t_set = 25 + (i % 2200) * 0.1;
+		double t_bottom = t_set - 5 + (i % 17) * 0.25;
+		int t_manual = 150 + i % 250;
+		unsigned int time = i % 1000;
+		double p = (i % 500) * 0.1;
+		double corr = -5 + (i % 100) * 0.1;
+
+		bench_clock::time_point t0 = bench_clock::now();
+		String(status).toCharArray(s_text[0], 5);
+		(String(round(t_set)) + "C").toCharArray(s_text[1], 5);
+		(String(round(t_bottom)) + "C").toCharArray(s_text[2], 5);
+		(String(round(t_manual)) + "C").toCharArray(s_text[3], 5);
+		(String(time) + "s").toCharArray(s_text[4], 5);
+		String(p).toCharArray(s_text[5], 6);
+		(String(corr) + "C").toCharArray(s_text[6], 6);
+		ns_s += elapsedNs(t0);
+
+		t0 = bench_clock::now();
+		fmtInt(f_text[0], 5, status);
+		fmtTemper(f_text[1], 5, t_set);
+		fmtTemper(f_text[2], 5, t_bottom);
+		fmtInt(f_text[3], 5, t_manual, "C");
+		fmtInt(f_text[4], 5, time, "s");
+		fmtFixed(f_text[5], 6, round(p * 100), 2);
+		fmtFixed(f_text[6], 6, round(corr * 100), 2, "C");
+		ns_f += elapsedNs(t0);
+
+		for (byte j = 0; j < 7; j++)
+			if (strcmp(s_text[j], f_text[j]))
+			{
+				if (mismatches++ < 5)
+					printf("mismatch: \"%s\" vs \"%s\"\n", s_text[j], f_text[j]);
+			}
+	}
+
+	printf("String fields    %6.1f ns per screen\n", (double)ns_s / N);
+	printf("format.h fields  %6.1f ns per screen\n", (double)ns_f / N);
+	printf("mismatches       %u of %u fields\n", mismatches, N * 7);
+	return mismatches == 0;
+}
+
+static Encoder *bench_enc = NULL;
+
+static void benchEncoderISR()
+{
+	bench_enc->isrTick();
+}
+
+/**
+ * @brief detents made while loop() is stalled, then seen by tick(): polled vs interrupt mode
+ */
+static void benchEncoder()
+{
+	const uint8_t CLK = 20, DT = 21, SW = 22;	// spare pins, idle HIGH
+	static const uint8_t right[4][2] = { {0, 1}, {0, 0}, {1, 0}, {1, 1} };
+
+	for (uint8_t isr = 0; isr < 2; isr++)
+	{
+		halReset();
+		Encoder enc(CLK, DT, SW, TYPE2);
+		bench_enc = &enc;
+		enc.setInterrupt(isr);
+		if (isr)
+		{
+			attachInterrupt(digitalPinToInterrupt(CLK), benchEncoderISR, CHANGE);
+			attachInterrupt(digitalPinToInterrupt(DT), benchEncoderISR, CHANGE);
+		}
+
+		uint32_t made = 0, seen = 0;
+		uint64_t ns = 0, ticks = 0;
+		for (uint32_t burst = 1; burst <= 12; burst++)
+		{
+			// a slow frame: `burst` detents 5 ms apart, no tick() in between
+			for (uint32_t i = 0; i < burst; i++, made++)
+				for (uint8_t s = 0; s < 4; s++)
+				{
+					halSetPin(CLK, right[s][0]);
+					halSetPin(DT, right[s][1]);
+					halAdvanceMicros(1250);
+				}
+			for (uint32_t i = 0; i < 20; i++, ticks++)
+			{
+				bench_clock::time_point t0 = bench_clock::now();
+				enc.tick();
+				ns += elapsedNs(t0);
+				if (enc.isRight()) seen++;
+				halAdvanceMicros(1000);
+			}
+		}
+		printf("%-10s %u of %u detents, %.1f ns per tick(), %u lost\n", isr ? "interrupt" : "polled",
+			seen, made, (double)ns / ticks, enc.getLost());
+	}
+
+	// acceleration: 20 detents at a steady speed, value change with the menu curve
+	static const byte curve[][2] = { {25, 10}, {50, 5}, {100, 2} };
+	static const uint32_t interval_ms[] = { 200, 80, 40, 15 };
+	for (uint8_t k = 0; k < 4; k++)
+	{
+		halReset();
+		Encoder enc(CLK, DT, SW, TYPE2);
+		enc.setAcceleration(curve, 3);
+		int value = 0;
+		for (uint32_t i = 0; i < 20; i++)
+			for (uint8_t s = 0; s < 4; s++)
+			{
+				halSetPin(CLK, right[s][0]);
+				halSetPin(DT, right[s][1]);
+				halAdvanceMicros(interval_ms[k] * 250);
+				enc.tick();
+				if (enc.isRight()) value += enc.getAccel();
+			}
+		printf("20 detents %3u ms apart: +%d\n", interval_ms[k], value);
+	}
+
+	// the same 40 ms detents queued by the interrupt while loop() is stalled for a full queue
+	const uint32_t stalled = ENC_QUEUE - 1;	// detents, 600 ms: longer than a 7-bit millis() stamp lasts
+	halReset();
+	Encoder enc(CLK, DT, SW, TYPE2);
+	bench_enc = &enc;
+	enc.setInterrupt(true);
+	enc.setAcceleration(curve, 3);
+	attachInterrupt(digitalPinToInterrupt(CLK), benchEncoderISR, CHANGE);
+	attachInterrupt(digitalPinToInterrupt(DT), benchEncoderISR, CHANGE);
+	int value = 0;
+	for (uint32_t i = 1; i <= 2 * stalled; i++)
+	{
+		for (uint8_t s = 0; s < 4; s++)
+		{
+			halSetPin(CLK, right[s][0]);
+			halSetPin(DT, right[s][1]);
+			halAdvanceMicros(40 * 250);
+		}
+		if (i % stalled == 0)
+			for (uint32_t j = 0; j < stalled; j++)
+			{
+				enc.tick();
+				if (enc.isRight()) value += enc.getAccel();
+			}
+	}
+	printf("%u detents  40 ms apart, read after %u ms stalls: +%d\n", 2 * stalled, stalled * 40, value);
+}
+
+/**
+ * @brief one mpcStep() against the same step in double, default profile and model
+ */
+static void benchMPC()
+{
+	const uint32_t RUNS = 2000;
+	ProfileS profile;
+	ProfileTable table;
+	profileDefault(profile);
+	profileCompile(table, profile, 25);
+
+	PlantModel model = {OBSERVER_RISE, OBSERVER_TAU, OBSERVER_LAG};
+	double a[MPC_POINTS], g[MPC_POINTS], gg = 0;
+	for (int k = 0; k < MPC_POINTS; k++)
+	{
+		a[k] = exp(-(double)MPC_STEP * (k + 1) / model.tau);
+		g[k] = model.rise * model.tau * (1 - a[k]);
+		gg += g[k] * g[k];
+	}
+	double a1 = exp(-MPC_PERIOD / 1000.0 / model.tau), g1 = model.rise * model.tau * (1 - a1);
+
+	uint64_t ns = 0;
+	uint32_t steps = 0, seed = 1;
+	double max_diff = 0, sum_diff = 0;
+
+	for (uint32_t run = 0; run < RUNS; run++)
+	{
+		mpcStart(model, 25, millis());
+		table.pos = 0;
+		double plate = 25, bias = 0, lastT = 0, lastU = 0;
+		bool started = false;
+		long temper;
+		byte phase;
+
+		for (unsigned int t = 0; profileSetpoint(table, t, temper, phase); t++)
+		{
+			halAdvanceMicros(MPC_PERIOD * 1000UL);
+			seed = seed * 1103515245UL + 12345UL;
+			plate = (double)temper / 65536 - 3 + ((seed >> 16) % 600) / 100.0;
+
+			double duty = 0;
+			bench_clock::time_point t0 = bench_clock::now();
+			mpcStep(plate, table, t, millis(), duty);
+			ns += elapsedNs(t0);
+			steps++;
+
+			// reference
+			double T = plate - 25;
+			if (started)
+				bias += (T - (lastT * a1 + g1 * lastU)) * MPC_BIAS / g1;
+			bias = bias > 1 ? 1 : (bias < -1 ? -1 : bias);
+			double sum = 0;
+			for (int k = 0; k < MPC_POINTS; k++)
+				sum += g[k] / gg * ((double)profilePeek(table, t + MPC_STEP * (k + 1)) / 65536 - 25 - T * a[k]);
+			double u = sum - bias;
+			u = u > 1 ? 1 : (u < 0 ? 0 : u);
+			lastT = T;
+			lastU = u + bias;
+			started = true;
+
+			double diff = fabs(duty - u);
+			sum_diff += diff;
+			if (diff > max_diff) max_diff = diff;
+		}
+	}
+
+	printf("mpcStep                %6.1f ns (%u steps)\n", (double)ns / steps, steps);
+	printf("duty against double    max %.5f, mean %.6f (duty 0-1)\n", max_diff, sum_diff / steps);
+}
+
+/**
+ * @brief one learning run with a constant error, then runs with none: the
+ * table has to stay as it is, for every level the first run leaves
+ */
+static bool benchILC()
+{
+	const int RUNS = 40;
+	ProfileS profile;
+	profileDefault(profile);
+	unsigned int total = 0;
+	for (byte i = 0; i < profile.count; i++)
+		total += profile.point[i].time;
+	unsigned int bin = (total + ILC_BINS - 1) / ILC_BINS;
+
+	uint64_t ns = 0;
+	uint32_t steps = 0, levels = 0, drifted = 0;
+	for (int e = -40; e <= 40; e++)
+	{
+		ilcReset(0);
+		ilcStart(0, profile, 0);
+		for (unsigned int t = 0; t < total; t++)
+			ilcSample(t, e * 0.25);
+		ilcEnd();
+
+		double first[ILC_BINS], u[ILC_BINS];
+		ilcStart(0, profile, 0);
+		for (byte j = 0; j < ILC_BINS; j++)
+			first[j] = ilcCorrection(bin * j + bin / 2);
+		ilcEnd();
+
+		bool changed = false;
+		for (int run = 0; run < RUNS; run++)
+		{
+			ilcStart(0, profile, 0);
+			for (unsigned int t = 0; t < total; t++)
+			{
+				bench_clock::time_point t0 = bench_clock::now();
+				ilcCorrection(t);
+				ilcSample(t, 0);
+				ns += elapsedNs(t0);
+				steps++;
+			}
+			ilcEnd();
+		}
+		ilcStart(0, profile, 0);
+		for (byte j = 0; j < ILC_BINS; j++)
+		{
+			u[j] = ilcCorrection(bin * j + bin / 2);
+			if (u[j] != first[j])
+				changed = true;
+		}
+		ilcStop();
+
+		levels++;
+		if (changed && drifted++ < 5)
+			printf("drift: error %.2f C, bin 0 %+.4f -> %+.4f duty\n", e * 0.25, first[0], u[0]);
+	}
+	ilcReset(0);
+
+	printf("ilcCorrection+ilcSample %6.1f ns (%u seconds)\n", (double)ns / steps, steps);
+	printf("drifted in %d zero-error runs %u of %u tables\n", RUNS, drifted, levels);
+	return drifted == 0;
+}
+
+int runBench(const char *name)
+{
+	bool ok = true;
+	if (!strcmp(name, "pid"))
+		ok = benchPID();
+	else if (!strcmp(name, "format"))
+		ok = benchFormat();
+	else if (!strcmp(name, "encoder"))
+		benchEncoder();
+	else if (!strcmp(name, "mpc"))
+		benchMPC();
+	else if (!strcmp(name, "ilc"))
+		ok = benchILC();
+	else
+		return -1;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,12 @@
+#ifndef IHC_BENCHMARKS_h
+#define IHC_BENCHMARKS_h
+
+/**
+ * @brief runs a named host benchmark, prints the result
+ *
+ * @return 0, 1 if a check of the benchmark failed, -1 if there is no
+ * benchmark with that name
+ */
+int runBench(const char *name);
+
+#endif
@@ -0,0 +1,487 @@
+/*
+	Native runner: calls setup()/loop() against NativeHAL on simulated time
+	and reports how much host time loop() costs. With --sim the MAX6675 is
+	fed by ThermalPlant, driven by Pin_HOT, and the run reports how well
+	T_Set was tracked.
+
+	ihc [--seconds N] [--step-us U] [--mode M] [--start] [--eeprom FILE] [--screen] [--verbose]
+	    [--sim] [--P p] [--I i] [--D d] [--pulse ms] [--csv FILE] [--page-us U] [--draw-us U] [--latency]
+	    [--telemetry FILE] [--dump] [--noise C] [--glitch F] [--observer] [--autotune]
+	    [--feedforward] [--gain FROM:P:I:D]... [--mpc] [--identify] [--power W] [--loss WK] [--dead-time S]
+	    [--ilc RUNS] [--step FROM:TO:AT]
+	ihc --bench NAME    host benchmark, see benchmarks.cpp
+*/
+
+#include <NativeHAL.h>
+#include <EEPROM.h>
+#include <ThermalPlant.h>
+#include <stdio.h>
+#include <chrono>
+#include "../ihc.h"
+#include "../ssr.h"
+#include "../sensor.h"
+#include "../observer.h"
+#include "../autotune.h"
+#include "../mpc.h"
+#include "../ident.h"
+#include "../ilc.h"
+#include "benchmarks.h"
+
+// pins as wired in src/main.cpp
+static const uint8_t ENC_CLK = 3;
+static const uint8_t ENC_DT = 4;
+static const uint8_t ENC_SW = 5;
+static const uint8_t HOT = 9;
+
+struct RunStats {
+	uint32_t loops;
+	uint64_t wall_ns;
+	uint64_t max_ns;
+};
+
+struct TrackStats {
+	uint32_t samples;
+	double sum_sq;		// (T_plate - T_Set)^2 while heating
+	double max_over;	// largest T_plate - T_Set
+	double max_under;	// largest T_Set - T_plate
+	double peak;		// highest plate temperature
+	double end_s;		// when heating stopped, 0 - still on
+	uint32_t liquidus;	// s with the plate above LIQUIDUS
+	uint32_t ramp_samples;
+	double ramp_sq;		// (T_plate - T_Set)^2 while T_Set rises
+	double max_over_up;	// largest T_plate - T_Set while T_Set does not fall
+	double last_set;
+	double sensor_sq;	// (T_Bottom - T_plate)^2
+	double estimate_sq;	// (observer estimate - T_plate)^2
+	uint32_t reach_samples;
+	double reach_sq;	// (T_plate - T_Set)^2 where the heater was not at the limit the error asks for
+};
+
+// manual mode setpoint step, plate response
+struct StepStats {
+	double from, to;	// C
+	double at;			// s into the run, 0 - no step
+	double start_s;		// s, simulated time of the step
+	double peak;		// plate, furthest past `from` in the direction of the step
+	double t10, t90;	// s after the step, plate 10% / 90% of the way, -1 - not yet
+	double settled;		// s after the step the plate last left 5% of the step around `to`
+};
+
+#define LIQUIDUS 217	// C, SAC305
+
+static RunStats stats;
+static TrackStats track;
+static StepStats step;
+static uint32_t step_us = 1000;
+static ThermalPlant *plant = NULL;
+static FILE *csv = NULL;
+static uint64_t next_sample_us = 0;
+
+static void toFile(const uint8_t *data, size_t len, void *ctx)
+{
+	fwrite(data, 1, len, (FILE *)ctx);
+}
+
+/**
+ * @brief 1 Hz sample of the closed loop while heating
+ */
+static void sample()
+{
+	if (!plant || halMicros64() < next_sample_us) return;
+	next_sample_us = halMicros64() + 1000000;
+
+	if (csv)
+		fprintf(csv, "%.0f,%.2f,%.2f,%.2f,%.1f,%d,%d\n", halMicros64() / 1e6, plant->plate(),
+			T_Bottom, T_Set, OutBottom, ProfilStatus, on_off);
+	if (!on_off) return;
+
+	double e = plant->plate() - T_Set;
+	track.samples++;
+	track.sum_sq += e * e;
+	if (e > track.max_over) track.max_over = e;
+	if (-e > track.max_under) track.max_under = -e;
+	if (plant->plate() > track.peak) track.peak = plant->plate();
+	if (plant->plate() > LIQUIDUS) track.liquidus++;
+	if (T_Set > track.last_set && track.samples > 1)
+	{
+		track.ramp_samples++;
+		track.ramp_sq += e * e;
+	}
+	if (T_Set >= track.last_set && e > track.max_over_up) track.max_over_up = e;
+	if (e < 0 ? OutBottom < EEprom.Pulse : OutBottom > 0)
+	{
+		track.reach_samples++;
+		track.reach_sq += e * e;
+	}
+	track.last_set = T_Set;
+	if (step.start_s > 0)
+	{
+		double t = halMicros64() / 1e6 - step.start_s;
+		double x = (plant->plate() - step.from) / (step.to - step.from);	// 0 -> 1
+		if (x > step.peak) step.peak = x;
+		if (step.t10 < 0 && x >= 0.1) step.t10 = t;
+		if (step.t90 < 0 && x >= 0.9) step.t90 = t;
+		if (fabs(x - 1) > 0.05) step.settled = t;
+	}
+	e = T_Bottom - plant->plate();
+	track.sensor_sq += e * e;
+	e = observerTemper() - plant->plate();
+	track.estimate_sq += e * e;
+}
+
+/**
+ * @brief runs loop() for the given simulated time, one step per call
+ */
+static void runFor(uint32_t ms, bool until_stop = false)
+{
+	uint64_t end = halMicros64() + (uint64_t)ms * 1000;
+	while (halMicros64() < end)
+	{
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		loop();
+		uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+		stats.loops++;
+		stats.wall_ns += ns;
+		if (ns > stats.max_ns) stats.max_ns = ns;
+		sample();
+		if (until_stop && !on_off)
+		{
+			track.end_s = halMicros64() / 1e6;
+			return;
+		}
+		halAdvanceMicros(step_us);
+	}
+}
+
+/**
+ * @brief the firmware's own serial command, answered on stdout within one serialTask period
+ */
+static void query(const char *cmd)
+{
+	halSerialSink(NULL, NULL);
+	halSerialMute(false);
+	halSerialInject(cmd, strlen(cmd));
+	runFor(150);
+	halSerialMute(true);
+}
+
+/**
+ * @brief one detent of a two-step encoder, dir > 0 - right
+ */
+static void turn(int dir)
+{
+	static const uint8_t right[4][2] = { {0, 1}, {0, 0}, {1, 0}, {1, 1} };
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		uint8_t s = dir > 0 ? i : (i + 2) % 4;
+		uint8_t clk = dir > 0 ? right[s][0] : right[s][1];
+		uint8_t dt = dir > 0 ? right[s][1] : right[s][0];
+		if (i == 3) clk = dt = HIGH;
+		halSetPin(ENC_CLK, clk);
+		halSetPin(ENC_DT, dt);
+		runFor(3);
+	}
+}
+
+/**
+ * @brief holds the encoder button long enough to start/stop heating
+ */
+static void hold()
+{
+	halSetPin(ENC_SW, LOW);
+	runFor(1200);
+	halSetPin(ENC_SW, HIGH);
+	runFor(100);
+}
+
+int main(int argc, char **argv)
+{
+	double seconds = 60;
+	int mode = -1;
+	bool start = false, screen = false, verbose = false, sim = false, latency = false, dump = false, observer = false, autotune = false, feedforward = false, mpc = false;
+	bool identify = false;
+	int ilc_runs = 0;
+	step.at = 0;
+	uint32_t page_us = HAL_PAGE_US, draw_us = HAL_DRAW_US;
+	double P = -1, I = -1, D = -1, pulse = -1;
+	GainBand gains[GAIN_BANDS];
+	uint8_t gain_count = 0;
+	PlantParams plant_params = ThermalPlant::defaults();
+	const char *eeprom = NULL, *csv_path = NULL, *telemetry_path = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--bench") && i + 1 < argc)
+		{
+			halReset();
+			int result = runBench(argv[++i]);
+			if (result >= 0) return result;
+			fprintf(stderr, "unknown benchmark %s\n", argv[i]);
+			return 2;
+		}
+		else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--step-us") && i + 1 < argc) step_us = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--mode") && i + 1 < argc) mode = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--eeprom") && i + 1 < argc) eeprom = argv[++i];
+		else if (!strcmp(argv[i], "--P") && i + 1 < argc) P = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--I") && i + 1 < argc) I = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--D") && i + 1 < argc) D = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--pulse") && i + 1 < argc) pulse = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--csv") && i + 1 < argc) csv_path = argv[++i];
+		else if (!strcmp(argv[i], "--page-us") && i + 1 < argc) page_us = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--draw-us") && i + 1 < argc) draw_us = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--latency")) latency = true;
+		else if (!strcmp(argv[i], "--dump")) dump = true;
+		else if (!strcmp(argv[i], "--observer")) observer = true;
+		else if (!strcmp(argv[i], "--autotune")) autotune = true;
+		else if (!strcmp(argv[i], "--feedforward")) feedforward = true;
+		else if (!strcmp(argv[i], "--mpc")) mpc = true;
+		else if (!strcmp(argv[i], "--identify")) identify = true;
+		else if (!strcmp(argv[i], "--ilc") && i + 1 < argc) ilc_runs = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--step") && i + 1 < argc)
+		{
+			if (sscanf(argv[++i], "%lf:%lf:%lf", &step.from, &step.to, &step.at) != 3 || step.from == step.to || step.at <= 0)
+			{
+				fprintf(stderr, "--step FROM:TO:AT\n");
+				return 2;
+			}
+			mode = 3;
+		}
+		else if (!strcmp(argv[i], "--gain") && i + 1 < argc && gain_count < GAIN_BANDS)
+		{
+			unsigned int from, p, d;
+			double ki;
+			if (sscanf(argv[++i], "%u:%u:%lf:%u", &from, &p, &ki, &d) != 4)
+			{
+				fprintf(stderr, "--gain FROM:P:I:D\n");
+				return 2;
+			}
+			GainBand &band = gains[gain_count++];
+			band.from = from;
+			band.P = p;
+			band.I = ki;
+			band.D = d;
+		}
+		else if (!strcmp(argv[i], "--noise") && i + 1 < argc) plant_params.noise = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--glitch") && i + 1 < argc) plant_params.glitch = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--power") && i + 1 < argc) plant_params.power = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--loss") && i + 1 < argc) plant_params.loss = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--dead-time") && i + 1 < argc) plant_params.dead_time = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--telemetry") && i + 1 < argc) telemetry_path = argv[++i];
+		else if (!strcmp(argv[i], "--start")) start = true;
+		else if (!strcmp(argv[i], "--sim")) sim = true;
+		else if (!strcmp(argv[i], "--screen")) screen = true;
+		else if (!strcmp(argv[i], "--verbose")) verbose = true;
+		else
+		{
+			fprintf(stderr, "usage: %s [--seconds N] [--step-us U] [--mode M] [--start] [--eeprom FILE] [--screen] [--verbose]\n"
+				"          [--sim] [--P p] [--I i] [--D d] [--pulse ms] [--csv FILE] [--page-us U] [--draw-us U] [--latency]\n"
+				"          [--telemetry FILE] [--dump] [--noise C] [--glitch F] [--observer] [--autotune]\n"
+				"          [--feedforward] [--gain FROM:P:I:D]... [--mpc] [--identify] [--power W] [--loss WK] [--dead-time S]\n"
+				"          [--ilc RUNS] [--step FROM:TO:AT]\n"
+				"       %s --bench NAME\n", argv[0], argv[0]);
+			return 2;
+		}
+	}
+	if (step_us == 0) step_us = 1;
+
+	halReset();
+	halSerialMute(!verbose);
+	halDisplayPageMicros(page_us);
+	halDisplayDrawMicros(draw_us);
+	if (eeprom) halEepromLoad(eeprom);
+
+	ThermalPlant thermal(HOT, plant_params);
+	if (sim)
+	{
+		plant = &thermal;
+		plant->attach();
+	}
+	if (csv_path)
+	{
+		csv = fopen(csv_path, "w");
+		if (csv) fprintf(csv, "time,plate,T_Bottom,T_Set,OutBottom,ProfilStatus,on\n");
+	}
+
+	FILE *telemetry = NULL;
+	if (telemetry_path)
+	{
+		// everything the firmware writes to Serial, frames and text
+		telemetry = fopen(telemetry_path, "wb");
+		if (telemetry)
+		{
+			halSerialSink(toFile, telemetry);
+			halSerialInject("t1", 2);
+		}
+	}
+
+	std::chrono::steady_clock::time_point wall0 = std::chrono::steady_clock::now();
+
+	setup();
+	if (observer) ObserverInput = true;
+	if (feedforward) FeedForward = ObserverInput = true;	// as serial "f1"
+	if (mpc) EEprom.Control = 7;	// all three profiles
+
+	// gains are read from EEprom by RunHot()
+	if (P >= 0) EEprom.P = P;
+	if (I >= 0) EEprom.I = I;
+	if (D >= 0) EEprom.D = D;
+	if (pulse > 0) EEprom.Pulse = pulse;
+	for (uint8_t i = 0; i < gain_count; i++) EEprom.Gain[i] = gains[i];
+
+	if (autotune)
+	{
+		// serial "a", the result line, "y" stores it; then the plate cools for the run
+		halSerialMute(false);
+		halSerialInject("a", 1);
+		runFor(1500);
+		runFor(AUTOTUNE_TIMEOUT * 1000UL, true);
+		printf("autotune      %.0f s\n", halMicros64() / 1e6);
+		query("y");
+		halSerialMute(!verbose);
+		while (plant && plant->plate() > plant->params().ambient + 5)
+			runFor(10000);
+		track = TrackStats();
+	}
+
+	if (identify)
+	{
+		// serial "i", the model line, "y" stores it; the fit against what the plant really is
+		halSerialMute(false);
+		halSerialInject("i", 1);
+		runFor(1500);
+		runFor((IDENT_SETTLE + IDENT_TIME + 10) * 1000UL, true);
+		query("y");
+		halSerialMute(!verbose);
+		if (plant)
+		{
+			const PlantParams &p = plant->params();
+			const PlantModel &m = observerModel();
+			printf("identified    rise %.2f C/s, tau %.0f s, lag %.1f s (plant %.2f C/s, %.0f s, %.1f s + read lag)\n",
+				m.rise, m.tau, m.lag, p.power / p.mass, p.mass / p.loss, p.dead_time + p.sensor_tau);
+		}
+		while (plant && plant->plate() > plant->params().ambient + 5)
+			runFor(10000);
+		track = TrackStats();
+	}
+
+	if (step.at > 0)
+	{
+		// manual mode held at FROM, T_manual moves to TO AT s into the run
+		EEprom.T_manual = step.from;
+		EEprom.Time_hold_manual = 0;
+	}
+	if (mode >= 0)
+	{
+		for (uint8_t i = 0; i < 3; i++) turn(-1);	// back to M1
+		for (int i = 0; i < mode; i++) turn(1);
+	}
+	if (ilc_runs > 0 && plant && EEprom.Mode < 3)
+	{
+		// the profile RUNS times to the end, cooling in between; the --start run comes after them
+		EEprom.Control = 7 << CONTROL_ILC;
+		halSerialMute(false);
+		for (int run = 1; run <= ilc_runs; run++)
+		{
+			hold();
+			runFor(3600000UL, true);
+			printf("ilc run %-4d  plate rms %.2f C, where the heater can act %.2f C, ramps rms %.2f C\n", run,
+				track.samples ? sqrt(track.sum_sq / track.samples) : 0.0,
+				track.reach_samples ? sqrt(track.reach_sq / track.reach_samples) : 0.0,
+				track.ramp_samples ? sqrt(track.ramp_sq / track.ramp_samples) : 0.0);
+			while (plant->plate() > plant->params().ambient + 1)	// the next run starts where this one did
+				runFor(10000);
+			track = TrackStats();
+		}
+		halSerialMute(!verbose);
+	}
+	if (start) hold();
+	if (step.at > 0 && step.at < seconds)
+	{
+		runFor((uint32_t)(step.at * 1000), start && sim);
+		EEprom.T_manual = step.to;
+		compileProfile();
+		step.start_s = halMicros64() / 1e6;
+		step.peak = 0;
+		step.t10 = step.t90 = -1;
+		step.settled = 0;
+		runFor((uint32_t)((seconds - step.at) * 1000), start && sim);
+	}
+	else
+		runFor((uint32_t)(seconds * 1000), start && sim);
+
+	if (latency)
+		query("l");
+	if (dump)
+		query("d");
+
+	double wall_ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - wall0).count() / 1e3;
+
+	if (eeprom) halEepromSave(eeprom);
+	if (csv) fclose(csv);
+	if (telemetry)
+	{
+		halSerialSink(NULL, NULL);
+		fclose(telemetry);
+	}
+
+	const HalDisplayStats &d = halDisplayStats();
+	printf("simulated     %.3f s in %.1f ms wall\n", halMicros64() / 1e6, wall_ms);
+	printf("loop() calls  %u\n", stats.loops);
+	printf("loop() mean   %.0f ns\n", stats.loops ? (double)stats.wall_ns / stats.loops : 0.0);
+	printf("loop() max    %llu ns\n", (unsigned long long)stats.max_ns);
+	printf("display       %u frames, %u pages, %u draw calls\n", d.frames, d.pages, d.draws);
+	printf("heater pin    %d\n", halGetPin(HOT));
+	unsigned long writes = 0, worn = 0;
+	for (int i = 0; i <= E2END; i++)
+	{
+		writes += halEepromWrites(i);
+		if (halEepromWrites(i) > worn) worn = halEepromWrites(i);
+	}
+	printf("eeprom writes %lu, most to one cell %lu\n", writes, worn);
+
+	static const char *task_names[TASKS] = { "output", "pid", "sensor", "profile", "telemetry", "display", "page", "encoder", "serial" };
+	for (uint8_t i = 0; i < TASKS; i++)
+		if (Tasks[i].period)
+			printf("task %-8s %lu runs, %u deadline misses, max late %u ms\n", task_names[i],
+				Tasks[i].runs, Tasks[i].misses, Tasks[i].maxLate);
+
+	printf("main screen   %lu frames, %lu skipped, frame %lu us (max %lu), page max %lu us\n", DisplayStat.frames,
+		DisplayStat.skipped, DisplayStat.frameLast, DisplayStat.frameMax, DisplayStat.pageMax);
+
+	const SsrStats &ssr = ssrStats();
+	if (ssr.windows)
+		printf("ssr windows   %lu, on-time error mean %lu us, max %lu us\n", ssr.windows,
+			ssr.sumError / ssr.windows, ssr.maxError);
+
+	if (plant)
+	{
+		printf("plate         %.2f C now, %.2f C peak, heater on %.1f s\n", plant->plate(), track.peak, plant->heaterOnSeconds());
+		printf("tracking      rms %.2f C, max over %.2f C, max under %.2f C\n",
+			track.samples ? sqrt(track.sum_sq / track.samples) : 0.0, track.max_over, track.max_under);
+		if (track.ramp_samples)
+			printf("ramps         rms %.2f C, max over while not cooling %.2f C\n",
+				sqrt(track.ramp_sq / track.ramp_samples), track.max_over_up);
+		printf("above %d C    %u s\n", LIQUIDUS, track.liquidus);
+		if (track.samples)
+			printf("plate error   T_Bottom rms %.2f C, observer rms %.2f C%s\n", sqrt(track.sensor_sq / track.samples),
+				sqrt(track.estimate_sq / track.samples), ObserverInput ? " (PID input)" : "");
+		if (mpc)
+			printf("mpc           model error d %.3f duty\n", mpcBias());
+		if (step.start_s > 0)
+			printf("step          %.0f -> %.0f C: overshoot %.1f%%, rise 10-90%% %.0f s, settled to 5%% %.0f s\n",
+				step.from, step.to, (step.peak - 1) * 100 > 0 ? (step.peak - 1) * 100 : 0.0, step.t10 >= 0 && step.t90 >= 0 ? step.t90 - step.t10 : -1.0, step.settled);
+		if (track.end_s > 0)
+			printf("run ended     %.1f s\n", track.end_s);
+	}
+
+	const SensorStats &sensor = sensorStats();
+	printf("sensor        %lu reads (%u early, %u stale), %u glitches, %u open, noise rms %.3f C, max %.3f C\n",
+		sensor.reads, sensor.early, plant ? plant->staleReads() : 0, sensor.glitches, sensor.open,
+		sensor.noise / 64.0, sensor.noiseMax / 64.0);
+
+	if (screen)
+		for (size_t i = 0; i < halDisplayLastFrame().size(); i++)
+			printf("  %s\n", halDisplayLastFrame()[i].c_str());
+	return 0;
+}
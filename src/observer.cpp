@@ -0,0 +1,65 @@
+#include "observer.h"
+
+static PlantModel model = {OBSERVER_RISE, OBSERVER_TAU, OBSERVER_LAG};
+
+static bool started = false;
+static unsigned long last;
+static double plate, stage, seen; //model: plate, first lag stage, what the sensor shows
+static double estimate, rate;
+
+void observerSetModel(const PlantModel &value)
+{
+  model = value;
+}
+
+const PlantModel &observerModel()
+{
+  return model;
+}
+
+/**
+ * @brief one measurement, duty 0..1 of the heater since the last one
+ */
+void observerUpdate(double measured, double duty, double ambient, unsigned long now)
+{
+  if (!started || now - last > 5000) //first read or after a stall: start from rest
+  {
+    plate = stage = seen = estimate = measured;
+    rate = 0;
+    last = now;
+    started = true;
+    return;
+  }
+  double dt = (now - last) / 1000.0;
+  last = now;
+
+  double before = plate;
+  plate += dt * (model.rise * duty - (plate - ambient) / model.tau);
+  double k = model.lag > 0 ? 1 - exp(-dt * 2 / model.lag) : 1;
+  stage += (plate - stage) * k;
+  seen += (stage - seen) * k;
+
+  double error = (measured - seen) * OBSERVER_GAIN;
+  plate += error;
+  stage += error;
+  seen += error;
+
+  rate = (plate - before) / dt;
+  estimate = measured + plate - seen;
+}
+
+/**
+ * @brief estimated plate temperature now, C
+ */
+double observerTemper()
+{
+  return estimate;
+}
+
+/**
+ * @brief estimated rate of rise, C/s
+ */
+double observerRate()
+{
+  return rate;
+}
@@ -0,0 +1,50 @@
+#ifndef IHC_OBSERVER_h
+#define IHC_OBSERVER_h
+
+#include <Arduino.h>
+
+/*
+	Plate temperature observer. The thermocouple sees the plate late (a
+	remote probe, the MAX6675 conversion and sensor.h filtering); a model
+	of the plate driven by the heater duty, seen through the same lag,
+	estimates what the plate is now:
+
+	  plate     dTp/dt = rise * duty - (Tp - ambient) / tau
+	  lag       two first-order stages of lag/2 each (transport delay and
+	            probe lag lumped together)
+	  estimate  T_Bottom + (Tp - Ts)
+
+	Only the lead the model adds is taken from it, the level is the
+	measurement's, so a model off by tens of percent gives a smaller lead
+	and never an offset. Every update also pulls the whole model chain
+	towards the measurement (a fixed-gain observer, OBSERVER_GAIN a read).
+	The rate is the model plate slope.
+
+	Off by default: serial "o1" feeds the estimate to the PID instead of
+	T_Bottom, "o0" goes back. The model runs either way.
+*/
+
+#ifndef OBSERVER_RISE
+#define OBSERVER_RISE 2.0  //C/s at full duty from ambient
+#endif
+#ifndef OBSERVER_TAU
+#define OBSERVER_TAU  200  //s, plate loss time constant
+#endif
+#ifndef OBSERVER_LAG
+#define OBSERVER_LAG  5.0  //s, plate to T_Bottom
+#endif
+#define OBSERVER_GAIN 0.05 //share of the model error taken out every update
+
+typedef struct PlantModelStruct {
+    double rise;    //C/s at full duty from ambient
+    double tau;     //s, loss time constant
+    double lag;     //s, plate to T_Bottom
+} PlantModel;
+
+void observerSetModel(const PlantModel &model);
+const PlantModel &observerModel(); //also what the feed-forward uses
+void observerUpdate(double measured, double duty, double ambient, unsigned long now);
+double observerTemper();
+double observerRate();
+
+#endif
@@ -0,0 +1,143 @@
+#include "profile.h"
+
+/**
+ * @brief appends a segment of the given length from the end of the table,
+ * zero-length segments are dropped
+ */
+static void addSegment(ProfileTable &table, unsigned int length, int from, int to, byte phase)
+{
+  if (length == 0) //nothing to interpolate
+    return;
+
+  ProfileSegment &seg = table.seg[table.count];
+  seg.temper = (long)from << PROFILE_Q;
+  seg.slope = ((long)(to - from) << PROFILE_Q) / (long)length;
+  seg.phase = phase;
+
+  table.count++;
+  unsigned long end = (unsigned long)seg.start + length;
+  table.seg[table.count].start = end > PROFILE_HOLD_FOREVER ? PROFILE_HOLD_FOREVER : end;
+}
+
+static void beginTable(ProfileTable &table)
+{
+  table.count = 0;
+  table.pos = 0;
+  table.seg[0].start = 0;
+}
+
+static void setPoint(ProfilePoint &point, unsigned int time, int temper, bool step)
+{
+  point.time = time > PROFILE_TIME_MAX ? PROFILE_TIME_MAX : time;
+  point.temper = temper < 0 ? 0 : (temper > PROFILE_TEMPER_MAX ? PROFILE_TEMPER_MAX : temper);
+  point.step = step;
+}
+
+/**
+ * @brief builds the classic 4-phase profile (ramp, soak, peak, final) from
+ * temperatures and phase times; the peak time is split into half up to
+ * temper[2] and half back down to temper[1]
+ */
+void profileFromPhases(ProfileS &profile, const int temper[4], const unsigned int timer[4])
+{
+  setPoint(profile.point[0], timer[0], temper[0], false);
+  setPoint(profile.point[1], timer[1], temper[1], false);
+  setPoint(profile.point[2], timer[2]/2, temper[2], false);
+  setPoint(profile.point[3], timer[2] - timer[2]/2, temper[1], false);
+  setPoint(profile.point[4], timer[3], temper[3], false);
+  profile.count = 5;
+}
+
+/**
+ * @brief the first start profile: to 145 C in 120 s, to 200 C in 90 s,
+ * 60 s peak through 250 C, down to 100 C in 60 s; also the benchmarks' profile
+ */
+void profileDefault(ProfileS &profile)
+{
+  const int temper[4] = {145, 200, 250, 100};
+  const unsigned int timer[4] = {120, 90, 60, 60};
+  profileFromPhases(profile, temper, timer);
+}
+
+/**
+ * @brief compiles an N-point profile, one segment per point
+ * 
+ * @param T_Ambient - start temperature
+ */
+void profileCompile(ProfileTable &table, const ProfileS &profile, byte T_Ambient)
+{
+  int prev = T_Ambient;
+
+  beginTable(table);
+  for (byte i = 0; i < profile.count && i < PROFILE_POINTS; i++)
+  {
+    const ProfilePoint &point = profile.point[i];
+    addSegment(table, point.time, point.step ? (int)point.temper : prev, point.temper, i + 1);
+    prev = point.temper;
+  }
+}
+
+/**
+ * @brief compiles manual mode: ramp to T_manual, then hold
+ * 
+ * @param hold - hold time, 0 - indefinitely
+ */
+void profileCompileManual(ProfileTable &table, int T_manual, unsigned int entry, unsigned int hold, byte T_Ambient)
+{
+  beginTable(table);
+  addSegment(table, entry, T_Ambient, T_manual, 0);
+  addSegment(table, hold != 0 ? hold : PROFILE_HOLD_FOREVER, T_manual, T_manual, 0);
+}
+
+/**
+ * @brief setpoint at the given run time
+ * 
+ * @param time - s from run start, must not go backwards between calls
+ * @param temper - Q16.16 C
+ * @param phase - phase of the segment
+ * @return false - the profile has ended
+ */
+bool profileSetpoint(ProfileTable &table, unsigned int time, long &temper, byte &phase)
+{
+  while (table.pos < table.count && time > table.seg[table.pos + 1].start)
+    table.pos++;
+  if (table.pos >= table.count)
+    return false;
+
+  const ProfileSegment &seg = table.seg[table.pos];
+  temper = seg.temper + seg.slope * (long)(time - seg.start);
+  phase = seg.phase;
+  return true;
+}
+
+/**
+ * @brief slope of the segment of the last profileSetpoint(), Q16.16 C per s
+ */
+long profileSlope(const ProfileTable &table)
+{
+  return table.pos < table.count ? table.seg[table.pos].slope : 0;
+}
+
+/**
+ * @brief setpoint at a later run time without moving the table on,
+ * the end temperature past the last segment
+ * 
+ * @param time - s from run start, not before the current segment
+ * @return Q16.16 C
+ */
+long profilePeek(const ProfileTable &table, unsigned int time)
+{
+  byte pos = table.pos;
+  while (pos < table.count && time > table.seg[pos + 1].start)
+    pos++;
+  if (pos >= table.count) //held at the end of the last segment
+  {
+    if (table.count == 0)
+      return 0;
+    pos = table.count - 1;
+    time = table.seg[table.count].start;
+  }
+
+  const ProfileSegment &seg = table.seg[pos];
+  return seg.temper + seg.slope * (long)(time - seg.start);
+}
@@ -0,0 +1,38 @@
+#ifndef IHC_PROFILE_h
+#define IHC_PROFILE_h
+
+#include "ihc.h"
+
+/*
+	Profile engine: a heating mode is compiled once (run start, profile
+	edit) into a table of linear segments, so the 1 s profile tick only
+	steps through the table and does one multiply-add in Q16.16.
+*/
+
+#define PROFILE_SEGMENTS PROFILE_POINTS	//one per control point
+
+typedef struct ProfileSegmentStruct {
+    unsigned int start;   //s from run start, the segment covers (start, next start]
+    long temper;          //temperature at start, Q16.16 C
+    long slope;           //Q16.16 C per s
+    byte phase;           //ProfilStatus while in the segment, 0 - manual
+} ProfileSegment;
+
+typedef struct ProfileTableStruct {
+    ProfileSegment seg[PROFILE_SEGMENTS + 1]; //last used entry only marks the end
+    byte count;
+    byte pos;             //current segment, only moves forward
+} ProfileTable;
+
+#define PROFILE_Q 16
+#define PROFILE_HOLD_FOREVER 0xFFFF
+
+void profileFromPhases(ProfileS &profile, const int temper[4], const unsigned int timer[4]);
+void profileDefault(ProfileS &profile);
+void profileCompile(ProfileTable &table, const ProfileS &profile, byte T_Ambient);
+void profileCompileManual(ProfileTable &table, int T_manual, unsigned int entry, unsigned int hold, byte T_Ambient);
+bool profileSetpoint(ProfileTable &table, unsigned int time, long &temper, byte &phase);
+long profileSlope(const ProfileTable &table);
+long profilePeek(const ProfileTable &table, unsigned int time);
+
+#endif
@@ -0,0 +1,255 @@
+#include "recorder.h"
+#include "format.h"
+
+#define RECORDER_MAGIC 0x5EC2
+#define BLOCK_NIBBLES (RECORDER_BLOCK*2)
+#define KEY_NIBBLES 15      //time 4, count 2, T_Bottom 3, T_Set 3, OutBottom 3
+#define ESCAPE 8
+
+typedef struct RecorderStruct {
+  unsigned int magic;
+  byte mode;
+  bool running;
+  unsigned int pulse;       //ms, OutBottom scale
+  byte head;                //oldest block
+  byte used;                //blocks in use
+  byte fill;                //nibbles used in the newest block
+  unsigned int next;        //s, time of the next sample
+  int lastT, lastSet, lastSlope, lastOut; //encoder state, 0.5 C and Pulse/32
+  byte data[RECORDER_BLOCKS][RECORDER_BLOCK];
+} Recorder;
+
+#ifdef __AVR__
+static Recorder Rec __attribute__((section(".noinit")));
+#else
+static Recorder Rec;
+#endif
+
+//dump state
+static bool dumping;
+static byte dumpBlock;      //blocks printed
+static byte dumpPos;        //nibble in the block
+static byte dumpLeft;       //samples left in the block
+static unsigned int dumpTime;  //s
+static int dumpT, dumpSet, dumpSlope, dumpOut;
+
+static byte getNibble(const byte *block, byte pos)
+{
+  return pos & 1 ? block[pos >> 1] >> 4 : block[pos >> 1] & 0x0F;
+}
+
+static void putNibble(byte *block, byte pos, byte value)
+{
+  if (pos & 1)
+    block[pos >> 1] = (block[pos >> 1] & 0x0F) | (value << 4);
+  else
+    block[pos >> 1] = (block[pos >> 1] & 0xF0) | (value & 0x0F);
+}
+
+static unsigned int getBits(const byte *block, byte &pos, byte nibbles)
+{
+  unsigned int value = 0;
+  for (byte i = 0; i < nibbles; i++)
+    value = (value << 4) | getNibble(block, pos++);
+  return value;
+}
+
+static void putBits(byte *block, byte &pos, unsigned int value, byte nibbles)
+{
+  while (nibbles-- > 0)
+    putNibble(block, pos++, value >> (4*nibbles));
+}
+
+static int getResidual(const byte *block, byte &pos)
+{
+  byte nibble = getNibble(block, pos++);
+  if (nibble != ESCAPE)
+    return nibble & 0x08 ? (int)nibble - 16 : nibble;
+  int value = getBits(block, pos, 3);
+  return value & 0x800 ? value - 0x1000 : value;
+}
+
+static byte residualSize(int value)
+{
+  return value >= -7 && value <= 7 ? 1 : 4;
+}
+
+static bool residualFits(int value)
+{
+  return value >= -2048 && value <= 2047;
+}
+
+static void putResidual(byte *block, byte &pos, int value)
+{
+  if (residualSize(value) == 1)
+    putNibble(block, pos++, value);
+  else
+  {
+    putNibble(block, pos++, ESCAPE);
+    putBits(block, pos, value, 3);
+  }
+}
+
+static byte *newest()
+{
+  return Rec.data[(Rec.head + Rec.used - 1) % RECORDER_BLOCKS];
+}
+
+/**
+ * @brief keeps a ring left from before a reset, clears anything else
+ */
+void recorderBegin()
+{
+  if (Rec.magic != RECORDER_MAGIC || Rec.head >= RECORDER_BLOCKS || Rec.used > RECORDER_BLOCKS 
+      || Rec.fill > BLOCK_NIBBLES)
+  {
+    memset(&Rec, 0, sizeof(Rec));
+    Rec.magic = RECORDER_MAGIC;
+  }
+  Rec.running = false; //a reset ends the run
+  dumping = false;
+}
+
+void recorderStart(byte mode, unsigned int pulse)
+{
+  memset(&Rec, 0, sizeof(Rec));
+  Rec.magic = RECORDER_MAGIC;
+  Rec.mode = mode;
+  Rec.pulse = pulse;
+  Rec.running = true;
+  dumping = false;
+}
+
+void recorderStop()
+{
+  Rec.running = false;
+}
+
+/**
+ * @brief from the 1 s profile tick, keeps one sample every RECORDER_PERIOD s
+ */
+void recorderSample(unsigned int time, double temper, double setpoint, double out)
+{
+  if (!Rec.running || time < Rec.next)
+    return;
+
+  int qT = round(temper*2);
+  int qSet = round(setpoint*2);
+  int qOut = Rec.pulse != 0 ? round(out*32/Rec.pulse) : 0;
+  qT = qT < 0 ? 0 : (qT > 0xFFF ? 0xFFF : qT);
+  qSet = qSet < 0 ? 0 : (qSet > 0xFFF ? 0xFFF : qSet);
+
+  int step = qSet - Rec.lastSet;
+  int rSet = step - Rec.lastSlope;
+  int rT = qT - (Rec.lastT + step);
+  int rOut = qOut - Rec.lastOut;
+  byte size = residualSize(rSet) + residualSize(rT) + residualSize(rOut);
+
+  byte *block = Rec.used != 0 ? newest() : NULL;
+  byte pos = 4;
+  byte count = block != NULL ? getBits(block, pos, 2) : 0;
+
+  //a late tick or a jump the residuals cannot hold (a sensor fault) goes into a key sample, exact
+  bool residuals = time == Rec.next && residualFits(rSet) && residualFits(rT) && residualFits(rOut);
+
+  if (block == NULL || !residuals || Rec.fill + size > BLOCK_NIBBLES || count == 0xFF)
+  {
+    //new block with a key sample, dropping the oldest when full
+    if (Rec.used < RECORDER_BLOCKS)
+      Rec.used++;
+    else
+      Rec.head = (Rec.head + 1) % RECORDER_BLOCKS;
+    block = newest();
+    pos = 0;
+    putBits(block, pos, time, 4);
+    putBits(block, pos, 1, 2);
+    putBits(block, pos, qT, 3);
+    putBits(block, pos, qSet, 3);
+    putBits(block, pos, qOut, 3);
+    Rec.fill = pos;
+    Rec.lastSlope = 0;
+  }
+  else
+  {
+    putResidual(block, Rec.fill, rSet);
+    putResidual(block, Rec.fill, rT);
+    putResidual(block, Rec.fill, rOut);
+    pos = 4;
+    putBits(block, pos, count + 1, 2);
+    Rec.lastSlope = step;
+  }
+
+  Rec.lastT = qT;
+  Rec.lastSet = qSet;
+  Rec.lastOut = qOut;
+  Rec.next = time + RECORDER_PERIOD;
+}
+
+/**
+ * @brief starts printing the ring, oldest sample first
+ */
+void recorderDump()
+{
+  if (Rec.running)
+  {
+    Serial.print(F("rec busy\n"));
+    return;
+  }
+
+  char line[24];
+  byte len = fmtInt(line, sizeof(line), Rec.mode, " pulse ");
+  len += fmtInt(line + len, sizeof(line) - len, Rec.pulse, " period ");
+  fmtInt(line + len, sizeof(line) - len, RECORDER_PERIOD);
+  Serial.print(F("rec mode "));
+  Serial.print(line);
+  Serial.print(F("\ntime,T_Bottom,T_Set,OutBottom\n"));
+
+  dumping = true;
+  dumpBlock = 0;
+  dumpLeft = 0;
+}
+
+/**
+ * @brief prints as many samples as the serial buffer takes without blocking
+ */
+void recorderDumpNext()
+{
+  char line[24];
+
+  while (dumping && Serial.availableForWrite() >= (int)sizeof(line))
+  {
+    const byte *block = Rec.data[(Rec.head + dumpBlock) % RECORDER_BLOCKS];
+    if (dumpLeft == 0)
+    {
+      if (dumpBlock >= Rec.used)
+      {
+        Serial.print(F("end\n"));
+        dumping = false;
+        break;
+      }
+      dumpPos = 0;
+      dumpTime = getBits(block, dumpPos, 4);
+      dumpLeft = getBits(block, dumpPos, 2);
+      dumpT = getBits(block, dumpPos, 3);
+      dumpSet = getBits(block, dumpPos, 3);
+      dumpOut = getBits(block, dumpPos, 3);
+      dumpSlope = 0;
+    }
+    else
+    {
+      dumpSlope += getResidual(block, dumpPos);
+      dumpSet += dumpSlope;
+      dumpT += dumpSlope + getResidual(block, dumpPos);
+      dumpOut += getResidual(block, dumpPos);
+      dumpTime += RECORDER_PERIOD;
+    }
+    if (--dumpLeft == 0)
+      dumpBlock++;
+
+    byte len = fmtInt(line, sizeof(line), dumpTime, ",");
+    len += fmtFixed(line + len, sizeof(line) - len, dumpT*5L, 1, ",");
+    len += fmtFixed(line + len, sizeof(line) - len, dumpSet*5L, 1, ",");
+    fmtInt(line + len, sizeof(line) - len, ((long)dumpOut*Rec.pulse + 16)/32, "\n");
+    Serial.print(line);
+  }
+}
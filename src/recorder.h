@@ -0,0 +1,43 @@
+#ifndef IHC_RECORDER_h
+#define IHC_RECORDER_h
+
+#include <Arduino.h>
+
+/*
+	Run recorder: every RECORDER_PERIOD s of a run (time, T_Bottom, T_Set,
+	OutBottom) goes into a RAM ring of RECORDER_BLOCKS blocks. A block
+	starts with a key sample (its time in s and absolute values) followed
+	by 4-bit residuals, 3 per sample, each RECORDER_PERIOD after the last:
+	  T_Set     change of its slope, 0.5 C (0 along a ramp or hold)
+	  T_Bottom  difference from the previous T_Bottom moved by the T_Set step, 0.5 C
+	  OutBottom change, Pulse/32
+	a residual outside -7..7 is the nibble 8 and 12 bits. A sample a late
+	profile tick took off the period, or with a residual past 12 bits,
+	starts a new block instead, so every row of the dump has its own time
+	and exact values. When the ring is full the oldest block is dropped,
+	so the end of a long run is kept.
+	About 3.3 nibbles a sample on the simulated plate, 25 samples a block:
+	the default 5 blocks (240 bytes) hold about 6 minutes at 3 s, a whole
+	run of the stock profiles; more does not fit the ATmega328's 2 KB.
+
+	On the AVR the ring is in .noinit, so it survives the reset the USB
+	serial adapter causes when a host opens the port. Serial "d" prints
+	it as CSV after the run, a few lines per serialTask() run.
+*/
+
+#ifndef RECORDER_PERIOD
+#define RECORDER_PERIOD 3   //s between samples
+#endif
+#ifndef RECORDER_BLOCKS
+#define RECORDER_BLOCKS 5
+#endif
+#define RECORDER_BLOCK 48   //bytes
+
+void recorderBegin();
+void recorderStart(byte mode, unsigned int pulse);
+void recorderSample(unsigned int time, double temper, double setpoint, double out);
+void recorderStop();
+void recorderDump();
+void recorderDumpNext();
+
+#endif
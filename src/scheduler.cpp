@@ -0,0 +1,111 @@
+#include "scheduler.h"
+
+#ifdef LOOP_STATS
+TaskTime LoopPeriod;
+static unsigned long lastPass;
+
+/**
+ * @brief adds one measurement
+ */
+void timeAdd(TaskTime &time, unsigned long us)
+{
+  if (time.count == 0 || us < time.min)
+    time.min = us;
+  if (us > time.max)
+    time.max = us;
+  unsigned long low = time.sumUs + us; //shifts, a division by 1000 would cost more than most tasks
+  time.sum += low >> 10;
+  time.sumUs = low & 1023;
+  time.count++;
+
+  byte bucket = 0;
+  for (unsigned long limit = 16; bucket < TASK_HIST-1 && us >= limit; limit <<= 2)
+    bucket++;
+  if (time.hist[bucket] != 0xFFFF)
+    time.hist[bucket]++;
+}
+
+unsigned long timeMean(const TaskTime &time)
+{
+  return time.count != 0 ? (time.sum * 1024.0 + time.sumUs) / time.count + 0.5 : 0;
+}
+
+/**
+ * @brief clears the run times of all tasks and the loop() period
+ */
+void schedulerResetTimes(Task *tasks, byte count)
+{
+  for (byte i = 0; i < count; i++)
+    memset(&tasks[i].time, 0, sizeof(TaskTime));
+  memset(&LoopPeriod, 0, sizeof(TaskTime));
+  lastPass = 0;
+}
+
+#define RUN(task) \
+  do { unsigned long t0 = micros(); (task).run(); timeAdd((task).time, micros() - t0); } while (0)
+#else
+#define RUN(task) (task).run()
+#endif
+
+/**
+ * @brief first run of every periodic task one period from now
+ */
+void schedulerStart(Task *tasks, byte count, unsigned long now)
+{
+  for (byte i = 0; i < count; i++)
+    tasks[i].due = now + tasks[i].period;
+}
+
+/**
+ * @brief one loop() pass: the highest priority due task plus all period 0 tasks
+ */
+void schedulerRun(Task *tasks, byte count, unsigned long now)
+{
+  bool ran = false;
+
+#ifdef LOOP_STATS
+  unsigned long pass = micros();
+  if (lastPass != 0)
+    timeAdd(LoopPeriod, pass - lastPass);
+  lastPass = pass;
+#endif
+
+  for (byte i = 0; i < count; i++)
+  {
+    Task &task = tasks[i];
+
+    if (task.period == 0)
+    {
+      RUN(task);
+      task.runs++;
+      continue;
+    }
+
+    long late = (long)(now - task.due);
+    if (ran || late < 0)
+      continue;
+
+    if ((unsigned long)late > task.maxLate)
+      task.maxLate = late > 0xFFFF ? 0xFFFF : late;
+    if ((unsigned long)late > task.deadline)
+      task.misses++;
+
+    //fixed rate; after a long stall start over instead of bursting to catch up
+    task.due += task.period;
+    if ((long)(now - task.due) >= 0)
+      task.due = now + task.period;
+
+    RUN(task);
+    task.runs++;
+    ran = true;
+  }
+}
+
+/**
+ * @brief changes the period, the next run is one new period from now
+ */
+void schedulerSetPeriod(Task &task, unsigned int period, unsigned long now)
+{
+  task.period = period;
+  task.due = now + period;
+}
@@ -0,0 +1,64 @@
+#ifndef IHC_SCHEDULER_h
+#define IHC_SCHEDULER_h
+
+#include <Arduino.h>
+
+/*
+	Cooperative scheduler over a static task table. The table order is the
+	priority: each loop() pass runs the first periodic task that is due and
+	every task with period 0, so a slow task (display) can delay the next
+	one by at most its own run time and never reorders control work.
+	Due times are compared as a signed difference, correct across the
+	millis() wraparound.
+
+	With -DLOOP_STATS every run is also timed with micros() (min, max,
+	mean, histogram per task and the loop() period).
+*/
+
+typedef void (*TaskFunc)();
+
+#ifdef LOOP_STATS
+#define TASK_HIST 8 //run time buckets x4 wide: <16 us, <64, <256 ... <64 ms, longer
+
+typedef struct TaskTimeStruct {
+    unsigned long count;
+    unsigned long min;      //us
+    unsigned long max;      //us
+    unsigned long sum;      //1024 us: wraps after 51 days, in us the loop() period sum would after 72 min
+    unsigned int sumUs;     //us, the rest of the sum below 1024
+    unsigned int hist[TASK_HIST];
+} TaskTime;
+
+extern TaskTime LoopPeriod; //us between schedulerRun() calls
+#endif
+
+typedef struct TaskStruct {
+    TaskFunc run;
+    unsigned int period;    //ms, 0 - every pass
+    unsigned int deadline;  //ms late before the run counts as a miss
+    unsigned long due;      //millis() of the next run
+    unsigned long runs;
+    unsigned int misses;    //runs later than deadline
+    unsigned int maxLate;   //ms, worst start jitter
+#ifdef LOOP_STATS
+    TaskTime time;          //run time
+#endif
+} Task;
+
+#ifdef LOOP_STATS
+#define TASK(run, period, deadline) {run, period, deadline, 0, 0, 0, 0, {0, 0, 0, 0, 0, {0}}}
+#else
+#define TASK(run, period, deadline) {run, period, deadline, 0, 0, 0, 0}
+#endif
+
+void schedulerStart(Task *tasks, byte count, unsigned long now);
+void schedulerRun(Task *tasks, byte count, unsigned long now);
+void schedulerSetPeriod(Task &task, unsigned int period, unsigned long now);
+
+#ifdef LOOP_STATS
+void timeAdd(TaskTime &time, unsigned long us);
+unsigned long timeMean(const TaskTime &time); //us
+void schedulerResetTimes(Task *tasks, byte count);
+#endif
+
+#endif
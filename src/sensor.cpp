@@ -0,0 +1,117 @@
+#include "sensor.h"
+
+static unsigned long lastRead;
+static bool primed = false;     //history holds real reads
+static int history[3];          //counts, 0.25 C
+static byte next;
+static long output;             //1/64 C
+static byte openRun;
+static byte glitchRun;          //reads in a row held out as glitches
+static byte settled;            //reads since the last glitch or restart, for the noise
+static unsigned long variance;  //(1/64 C)^2, square of the second difference over the last ~16 reads
+static SensorStats stats;
+
+static int median3(int a, int b, int c)
+{
+  if (a > b) { int t = a; a = b; b = t; }
+  if (b > c) b = c;
+  return a > b ? a : b;
+}
+
+/**
+ * @brief false while the conversion started by the last read is still running
+ */
+bool sensorReady(unsigned long now)
+{
+  if (primed && now - lastRead < SENSOR_CONVERSION)
+  {
+    stats.early++;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief noise from the second difference of the reads: 0 along a ramp,
+ * 6 times the variance for independent noise
+ */
+static void noiseAdd(int count)
+{
+  if (settled < 2)
+  {
+    settled++;
+    return;
+  }
+  byte prev = next == 0 ? 2 : next - 1;
+  byte prev2 = prev == 0 ? 2 : prev - 1;
+  long d2 = (long)count - 2L*history[prev] + history[prev2];
+  d2 = d2 > 255 ? 255 : (d2 < -255 ? -255 : d2);
+  unsigned long square = (d2 * d2) << 8;
+  variance = square > variance ? variance + (square - variance) / 16 : variance - (variance - square) / 16;
+  stats.noise = sqrt(variance / 6.0);
+  unsigned int jump = abs(d2) * 16;
+  if (jump > stats.noiseMax)
+    stats.noiseMax = jump;
+}
+
+/**
+ * @brief one read of the MAX6675 in C, returns the filtered temperature in C
+ */
+double sensorFilter(double raw, unsigned long now)
+{
+  lastRead = now;
+  stats.reads++;
+
+  if (isnan(raw) || raw < 0 || raw > 1023.75)
+  {
+    stats.open++;
+    if (openRun < SENSOR_OPEN)
+      openRun++;
+    if (openRun < SENSOR_OPEN && primed)
+      return output / 64.0;
+    primed = false; //start over when the thermocouple is back
+    output = 0;
+    return 0;
+  }
+  openRun = 0;
+
+  int count = round(raw * 4);
+  if (primed && abs(((long)count << 4) - output) > SENSOR_GLITCH * 16L)
+  {
+    stats.glitches++;
+    settled = 0;
+    if (++glitchRun < 3)
+      return output / 64.0;
+    primed = false; //three in a row: a real step, start over there
+  }
+  glitchRun = 0;
+
+  if (!primed)
+  {
+    history[0] = history[1] = history[2] = count;
+    output = (long)count << 4;
+    primed = true;
+    settled = 0;
+  }
+  noiseAdd(count);
+  history[next] = count;
+  next = next == 2 ? 0 : next + 1;
+
+  long error = ((long)median3(history[0], history[1], history[2]) << 4) - output;
+  output += error >= -16 && error <= 16 ? error / 8 : error / 2;
+  return output / 64.0;
+}
+
+/**
+ * @brief clears the counters, the filter keeps running
+ */
+void sensorResetStats()
+{
+  memset(&stats, 0, sizeof(stats));
+  variance = 0;
+}
+
+const SensorStats &sensorStats()
+{
+  return stats;
+}
@@ -0,0 +1,46 @@
+#ifndef IHC_SENSOR_h
+#define IHC_SENSOR_h
+
+#include <Arduino.h>
+
+/*
+	MAX6675 sampling and filtering. A read (CS low) stops the conversion
+	in progress and the next one takes up to 220 ms, so a read sooner than
+	that returns the previous result again: sensorReady() holds a read
+	back until SENSOR_CONVERSION ms after the last one.
+
+	Each read, in 0.25 C counts, is first checked against the output: one
+	more than SENSOR_GLITCH counts away (a bit error on the SPI lines, a
+	spike from the relay) is held out, unless three come in a row - a real
+	step, the filter starts over there. Then
+	  median of the last 3  - smaller spikes never get through
+	  IIR                   - 1/8 while the median is within one count of the
+	                          output, i.e. quantization noise, 1/2 beyond
+	                          that, so a ramp is followed with about a
+	                          count of lag instead of a time constant
+	and out in 1/64 C. The noise is the rms second difference of the reads
+	(over sqrt 6), which a ramp does not add to. An open thermocouple (NAN,
+	or a reading out of 0..1023.75 C) keeps the last output; SENSOR_OPEN of
+	them in a row give 0 C, which the thermocouple test stops on.
+*/
+
+#define SENSOR_CONVERSION 220 //ms, longest MAX6675 conversion
+#define SENSOR_GLITCH 8       //counts between a read and the output that make it a glitch
+#define SENSOR_OPEN 4         //open reads in a row before the output drops to 0 C
+
+typedef struct SensorStatsStruct {
+    unsigned long reads;
+    unsigned int early;     //runs held back, conversion still in progress
+    unsigned int glitches;  //reads more than SENSOR_GLITCH from the output
+    unsigned int open;      //open thermocouple reads
+    unsigned int noise;     //1/64 C, rms noise of the reads, the last ~16
+    unsigned int noiseMax;  //1/64 C, largest second difference, glitches left out
+} SensorStats;
+
+bool sensorReady(unsigned long now);
+double sensorFilter(double raw, unsigned long now);
+void sensorResetStats();
+
+const SensorStats &sensorStats();
+
+#endif
@@ -0,0 +1,232 @@
+#include "ssr.h"
+
+#ifdef __AVR__
+#include <util/atomic.h>
+#define TICKS(ms) ((unsigned long)(ms) * 125 / 8) //clk/1024 at 16 MHz: 15.625 ticks per ms
+#endif
+
+static byte ssrPin;
+static bool running = false;
+static bool timer = false;      //Timer1 drives the pin
+static unsigned int window;     //ms
+static volatile unsigned int duty; //ms, requested, read by the Timer1 interrupts
+static SsrStats stats;
+
+//software window, also the measurement of it
+static unsigned int latched;    //ms, duty of the current window
+static unsigned long windowStart;
+static bool pinOn;
+static unsigned long onSince;   //us
+static unsigned long onTime;    //us in the current window
+
+static void account(unsigned long actual, unsigned int commanded)
+{
+  long error = (long)actual - (long)commanded * 1000;
+  unsigned long absError = error < 0 ? -error : error;
+  stats.windows++;
+  stats.lastError = error;
+  stats.sumError += absError;
+  if (absError > stats.maxError)
+    stats.maxError = absError;
+}
+
+#if defined(__AVR__) && defined(SSR_MEASURE)
+static volatile unsigned long isrStart;     //us, OC1A went high
+static volatile unsigned long isrOn;        //us, on-time of the window in progress
+static volatile unsigned long isrLast;      //us, on-time of the finished window
+static volatile unsigned int isrCommanded;  //ms, duty of the last window
+static volatile unsigned int isrDuty;       //ms, duty of the window in progress
+static volatile bool isrReady;
+
+//TOP: the window ends, OC1A goes high for the next one
+ISR(TIMER1_OVF_vect)
+{
+  unsigned long now = micros();
+  isrLast = isrDuty >= window ? now - isrStart : isrOn; //constantly on - no falling edge
+  isrCommanded = isrDuty;
+  isrReady = true;
+
+  isrDuty = duty;
+  isrStart = now;
+  isrOn = 0;
+}
+
+//compare match: OC1A goes low (the interrupt fires even with OC1A disconnected)
+ISR(TIMER1_COMPA_vect)
+{
+  if (isrDuty > 0 && isrDuty < window)
+    isrOn = micros() - isrStart;
+}
+#endif
+
+/**
+ * @brief starts the output with duty 0
+ * 
+ * @param window - ms, 1..4000 with Timer1
+ */
+void ssrBegin(byte pin, unsigned int windowMs)
+{
+  ssrPin = pin;
+  window = windowMs > 0 ? windowMs : 1;
+  duty = 0;
+  latched = 0;
+  stats = SsrStats();
+
+  pinMode(ssrPin, OUTPUT);
+  digitalWrite(ssrPin, 0);
+  pinOn = false;
+  onTime = 0;
+  windowStart = millis();
+
+#ifdef __AVR__
+  timer = ssrPin == SSR_OC1A_PIN && TICKS(window) <= 0x10000;
+  if (timer)
+  {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      TCCR1B = 0;
+      TCCR1A = _BV(WGM11);              //fast PWM, TOP = ICR1, OC1A disconnected until duty > 0
+      ICR1 = TICKS(window) - 1;
+      OCR1A = 0;
+      TCNT1 = 0;
+      TCCR1B = _BV(WGM13) | _BV(WGM12) | _BV(CS12) | _BV(CS10); //clk/1024
+#ifdef SSR_MEASURE
+      isrDuty = 0;
+      isrReady = false;
+      TIFR1 = _BV(TOV1) | _BV(OCF1A);
+      TIMSK1 = _BV(TOIE1) | _BV(OCIE1A);
+#endif
+    }
+  }
+#endif
+  running = true;
+}
+
+/**
+ * @brief on-time per window, applied from the next window
+ * 
+ * @param duty - ms, clamped to the window
+ */
+void ssrSet(double dutyMs)
+{
+  if (!running)
+    return;
+  unsigned int value = dutyMs <= 0 ? 0 : (dutyMs >= window ? window : (unsigned int)dutyMs);
+
+#ifdef __AVR__
+  if (timer)
+  {
+    unsigned long ticks = TICKS(value);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      duty = value;
+      if (ticks == 0)
+        TCCR1A &= ~_BV(COM1A1);         //a 0 compare value would still give a 1 tick pulse
+      else
+      {
+        OCR1A = ticks > ICR1 ? ICR1 : ticks - 1; //high for OCR1A + 1 ticks, TOP - always
+        TCCR1A |= _BV(COM1A1);
+      }
+    }
+    return;
+  }
+#endif
+  duty = value;
+}
+
+/**
+ * @brief every loop() pass: switches the pin when the window is done in
+ * software, collects the measurement of finished windows
+ */
+void ssrUpdate()
+{
+  if (!running)
+    return;
+
+#ifdef __AVR__
+  if (timer)
+  {
+#ifdef SSR_MEASURE
+    unsigned long on;
+    unsigned int commanded;
+    bool ready;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      ready = isrReady;
+      isrReady = false;
+      on = isrLast;
+      commanded = isrCommanded;
+    }
+    if (ready)
+    {
+      account(on, commanded);
+      Serial.print(F("SSR "));
+      Serial.print(commanded * 1000UL);
+      Serial.print(F(" us, on "));
+      Serial.print(on);
+      Serial.print(F(" us, err "));
+      Serial.print(stats.lastError);
+      Serial.print(F(" us\n"));
+    }
+#endif
+    return;
+  }
+#endif
+
+  unsigned long now = millis();
+  if (now - windowStart >= window)
+  {
+    if (pinOn)
+    {
+      unsigned long us = micros();
+      onTime += us - onSince;
+      onSince = us;
+    }
+    account(onTime, latched);
+    onTime = 0;
+
+    windowStart += window;
+    if (now - windowStart >= window) //stalled for more than a window
+      windowStart = now;
+    latched = duty;
+  }
+
+  bool on = latched > now - windowStart;
+  if (on != pinOn)
+  {
+    unsigned long us = micros();
+    if (on)
+      onSince = us;
+    else
+      onTime += us - onSince;
+    pinOn = on;
+    digitalWrite(ssrPin, on);
+  }
+}
+
+/**
+ * @brief relay off, Timer1 released
+ */
+void ssrStop()
+{
+#ifdef __AVR__
+  if (timer)
+  {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      TIMSK1 = 0;
+      TCCR1B = 0;
+      TCCR1A = 0;
+    }
+  }
+#endif
+  running = false;
+  timer = false;
+  pinOn = false;
+  digitalWrite(ssrPin, 0);
+}
+
+const SsrStats &ssrStats()
+{
+  return stats;
+}
@@ -0,0 +1,38 @@
+#ifndef IHC_SSR_h
+#define IHC_SSR_h
+
+#include <Arduino.h>
+
+/*
+	Time-proportioned SSR output: the relay is on for `duty` ms at the start
+	of every `window` ms.
+
+	On the ATmega328 with the relay on pin 9 (OC1A) the window is generated
+	by Timer1 in fast PWM (mode 14, clk/1024, 64 us per tick): edges do not
+	depend on loop() at all and a new duty is double-buffered by the
+	hardware, so it takes effect at the next window. Other pins and the
+	native build switch the pin from loop() (ssrUpdate() every pass), with
+	the duty latched at the start of each window.
+
+	Measurement: the on-time of every window is measured from the pin
+	edges and compared with the commanded duty. With -DSSR_MEASURE the AVR
+	measures in the Timer1 interrupts and prints each window on Serial.
+*/
+
+#define SSR_OC1A_PIN 9
+
+typedef struct SsrStatsStruct {
+    unsigned long windows;  //measured windows
+    long lastError;         //us, actual - commanded on-time of the last window
+    unsigned long maxError; //us, worst |error|
+    unsigned long sumError; //us, sum of |error|
+} SsrStats;
+
+void ssrBegin(byte pin, unsigned int window);
+void ssrSet(double duty);
+void ssrUpdate();
+void ssrStop();
+
+const SsrStats &ssrStats();
+
+#endif
@@ -0,0 +1,108 @@
+#include "store.h"
+#include <EEPROM.h>
+#include "crc.h"
+
+#define STORE_HEADER 4 //version, seq, len
+
+static int newest = -1; //address of the newest good record, -1 - none
+static uint16_t newestSeq;
+
+static unsigned int slotSize(byte size)
+{
+  return (STORE_HEADER + size + 2 + STORE_ALIGN - 1) / STORE_ALIGN * STORE_ALIGN;
+}
+
+/**
+ * @brief checks the record at addr, returns its data length or -1
+ */
+static int recordCheck(int addr)
+{
+  byte len = EEPROM.read(addr + 3);
+  if (addr + STORE_HEADER + len + 2 > E2END + 1)
+    return -1;
+
+  uint16_t crc = CRC16_INIT;
+  for (int i = 0; i < STORE_HEADER + len; i++)
+    crc = crc16(crc, EEPROM.read(addr + i));
+
+  int end = addr + STORE_HEADER + len;
+  if ((uint16_t)(EEPROM.read(end) | EEPROM.read(end + 1) << 8) != crc)
+    return -1;
+  return len;
+}
+
+/**
+ * @brief finds the newest good record and copies its data, at most size bytes
+ * (the rest of data is left as it was, defaults for fields a newer layout appended)
+ * @return false - no good record of version 1..version, data untouched
+ */
+bool storeLoad(void *data, byte size, byte &version)
+{
+  newest = -1;
+
+  //every boundary: a record of an older, shorter layout sits on its own slot size
+  for (unsigned int addr = 0; addr + STORE_HEADER + 2 <= E2END + 1; addr += STORE_ALIGN)
+  {
+    byte v = EEPROM.read(addr);
+    if (v == 0 || v > version || recordCheck(addr) < 0)
+      continue;
+    uint16_t seq = EEPROM.read(addr + 1) | EEPROM.read(addr + 2) << 8;
+    if (newest < 0 || (int16_t)(seq - newestSeq) > 0) //wraps around
+    {
+      newest = addr;
+      newestSeq = seq;
+    }
+  }
+  if (newest < 0)
+    return false;
+
+  byte len = EEPROM.read(newest + 3);
+  byte *p = (byte *)data;
+  for (byte i = 0; i < len && i < size; i++)
+    p[i] = EEPROM.read(newest + STORE_HEADER + i);
+  version = EEPROM.read(newest);
+  return true;
+}
+
+/**
+ * @brief writes data as a new record after the newest one, nothing if the
+ * newest record already holds the same version and data
+ */
+void storeSave(const void *data, byte size, byte version)
+{
+  const byte *p = (const byte *)data;
+
+  if (newest >= 0 && EEPROM.read(newest) == version && EEPROM.read(newest + 3) == size)
+  {
+    byte i = 0;
+    while (i < size && EEPROM.read(newest + STORE_HEADER + i) == p[i])
+      i++;
+    if (i == size)
+      return;
+  }
+
+  //slot 0 is written last: it may hold the image of the firmware before the store
+  unsigned int slot = slotSize(size);
+  unsigned int addr = newest < 0 ? slot : newest + slot;
+  if (addr + slot > E2END + 1)
+    addr = 0;
+  uint16_t seq = newest < 0 ? 0 : newestSeq + 1;
+
+  byte header[STORE_HEADER] = {version, (byte)seq, (byte)(seq >> 8), size};
+  unsigned int crc = CRC16_INIT;
+  for (byte i = 0; i < STORE_HEADER; i++)
+  {
+    EEPROM.update(addr + i, header[i]);
+    crc = crc16(crc, header[i]);
+  }
+  for (byte i = 0; i < size; i++)
+  {
+    EEPROM.update(addr + STORE_HEADER + i, p[i]);
+    crc = crc16(crc, p[i]);
+  }
+  EEPROM.update(addr + STORE_HEADER + size, crc);
+  EEPROM.update(addr + STORE_HEADER + size + 1, crc >> 8);
+
+  newest = addr;
+  newestSeq = seq;
+}
@@ -0,0 +1,28 @@
+#ifndef IHC_STORE_h
+#define IHC_STORE_h
+
+#include <Arduino.h>
+
+/*
+	Settings store: the EEPROM is cut into slots of the record size rounded
+	up to 16 bytes, as many as fit in E2END + 1 bytes (1 KB on an
+	ATmega328; the slot grows with the settings). Every save goes to the
+	slot after the newest one, so the writes spread over the whole chip
+	instead of wearing the same cells; a save of unchanged settings writes
+	nothing. A record is
+	  version | seq (2, LE) | len | data[len] | crc16 (2, LE)
+	with the CRC over everything before it. The newest record with a good
+	CRC wins, so a save cut by a reset leaves the previous one in place.
+	`version` is the layout of data: a record written by an older firmware
+	loads with its own version and length, for the caller to migrate.
+	Records are looked for at every 16-byte boundary, so the last record
+	of a shorter layout is found after a firmware update changed the slot
+	size.
+*/
+
+#define STORE_ALIGN 16
+
+bool storeLoad(void *data, byte size, byte &version);
+void storeSave(const void *data, byte size, byte version);
+
+#endif
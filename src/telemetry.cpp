@@ -0,0 +1,70 @@
+#include "telemetry.h"
+#include "ihc.h"
+
+static byte divider; //send every n-th run, 0 - off
+static byte skip;
+static byte seq;
+static unsigned long lastPasses;
+
+static byte *put16(byte *p, unsigned int value)
+{
+  *p++ = value;
+  *p++ = value >> 8;
+  return p;
+}
+
+static int temper16(double value)
+{
+  value *= TELEMETRY_TEMPER_SCALE;
+  return value > 32767 ? 32767 : (value < -32768 ? -32768 : round(value));
+}
+
+/**
+ * @brief 0 - off, n - a frame every n-th run of the task
+ */
+void telemetrySetDivider(byte value)
+{
+  divider = value;
+  skip = 0;
+  lastPasses = Tasks[TASK_OUTPUT].runs;
+}
+
+/**
+ * @brief at the PID rate, sends a frame when the divider is due
+ */
+void telemetryTask()
+{
+  if (divider == 0 || ++skip < divider)
+    return;
+  skip = 0;
+
+  unsigned long passes = Tasks[TASK_OUTPUT].runs - lastPasses; //period 0, runs every pass
+  lastPasses = Tasks[TASK_OUTPUT].runs;
+  unsigned long misses = 0;
+  for (byte i = 0; i < TASKS; i++)
+    misses += Tasks[i].misses;
+
+  byte frame[TELEMETRY_FRAME];
+  byte *p = frame;
+  *p++ = TELEMETRY_SYNC0;
+  *p++ = TELEMETRY_SYNC1;
+  *p++ = TELEMETRY_PAYLOAD;
+  *p++ = seq++;
+  unsigned long now = millis();
+  p = put16(p, now);
+  p = put16(p, now >> 16);
+  p = put16(p, temper16(T_Bottom));
+  p = put16(p, temper16(T_Set));
+  p = put16(p, OutBottom > 0 ? round(OutBottom) : 0);
+  *p++ = ProfilStatus;
+  *p++ = on_off ? TELEMETRY_HEATING : 0;
+  p = put16(p, passes > 0xFFFF ? 0xFFFF : passes);
+  p = put16(p, misses > 0xFFFF ? 0xFFFF : misses);
+
+  unsigned int crc = CRC16_INIT;
+  for (byte *c = frame + 2; c < p; c++)
+    crc = crc16(crc, *c);
+  p = put16(p, crc);
+
+  Serial.write(frame, p - frame);
+}
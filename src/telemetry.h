@@ -0,0 +1,17 @@
+#ifndef IHC_TELEMETRY_h
+#define IHC_TELEMETRY_h
+
+#include <Arduino.h>
+#include "telemetry_frame.h"
+
+/*
+	Binary telemetry: telemetryTask() runs at the PID task rate and sends
+	one 22-byte frame (see telemetry_frame.h) every `divider` runs, 5 Hz at
+	divider 1 is about 110 B/s of the 960 B/s a 9600 baud link carries.
+	Off by default; serial "t0".."t9" sets the divider.
+*/
+
+void telemetrySetDivider(byte divider);
+void telemetryTask();
+
+#endif
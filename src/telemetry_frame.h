@@ -0,0 +1,37 @@
+#ifndef IHC_TELEMETRY_FRAME_h
+#define IHC_TELEMETRY_FRAME_h
+
+#include <stdint.h>
+#include "crc.h"
+
+/*
+	Telemetry frame, shared by the firmware and tools/telemetry_decode.cpp.
+	All fields little-endian:
+
+	  0xA5 0x5A | len | seq | payload[len] | crc16
+
+	crc16 is CRC-16/CCITT-FALSE (crc.h) over len, seq
+	and the payload, low byte first. seq counts frames mod 256, so the
+	decoder can count lost ones. Text on the same port (RUN, STOP, ERROR)
+	falls between frames and is skipped by the decoder.
+
+	payload, TELEMETRY_PAYLOAD bytes:
+	  0  uint32  millis()
+	  4  int16   T_Bottom, 1/16 C
+	  6  int16   T_Set, 1/16 C
+	  8  uint16  OutBottom, ms on per SSR window
+	  10 uint8   ProfilStatus
+	  11 uint8   flags, TELEMETRY_HEATING
+	  12 uint16  loop() passes since the previous frame
+	  14 uint16  scheduler deadline misses, all tasks
+*/
+
+#define TELEMETRY_SYNC0 0xA5
+#define TELEMETRY_SYNC1 0x5A
+#define TELEMETRY_PAYLOAD 16
+#define TELEMETRY_FRAME (TELEMETRY_PAYLOAD + 6)
+#define TELEMETRY_TEMPER_SCALE 16
+
+#define TELEMETRY_HEATING 0x01
+
+#endif
@@ -0,0 +1,192 @@
+/*
+	Telemetry decoder: reads the IHC serial stream (a tty or a capture file)
+	and writes one CSV line per valid frame to stdout. Frame format in
+	src/telemetry_frame.h; bad CRCs, lost sequence numbers and skipped
+	bytes (text between frames) are counted and reported on stderr.
+
+	g++ -O2 -o telemetry_decode tools/telemetry_decode.cpp
+	telemetry_decode [-b baud] [-r N] /dev/ttyUSB0 > run.csv
+	telemetry_decode capture.bin > run.csv
+
+	-r N sends "tN" first (frame every N-th PID period, 1 - 5 Hz).
+	Stop a live capture with Ctrl-C, the CSV is flushed per line.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include "../src/telemetry_frame.h"
+
+struct DecodeStats {
+	unsigned long frames;
+	unsigned long crc_errors;
+	unsigned long lost;		// by sequence number
+	unsigned long skipped;	// bytes outside frames
+};
+
+static DecodeStats stats;
+static volatile sig_atomic_t stop = 0;
+
+static void onSignal(int) { stop = 1; }
+
+static uint16_t get16(const uint8_t *p) { return p[0] | (uint16_t)p[1] << 8; }
+static uint32_t get32(const uint8_t *p) { return get16(p) | (uint32_t)get16(p + 2) << 16; }
+
+static speed_t baudConstant(long baud)
+{
+	switch (baud)
+	{
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		default: return 0;
+	}
+}
+
+/**
+ * @brief raw 8N1 at the given baud rate, no-op on regular files
+ */
+static bool setupTty(int fd, long baud)
+{
+	if (!isatty(fd)) return true;
+	speed_t speed = baudConstant(baud);
+	if (!speed) return false;
+
+	struct termios tio;
+	if (tcgetattr(fd, &tio)) return false;
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cc[VMIN] = 1;
+	tio.c_cc[VTIME] = 0;
+	return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+static void printFrame(const uint8_t *payload, uint8_t seq)
+{
+	printf("%.3f,%.2f,%.2f,%u,%u,%u,%u,%u,%u\n",
+		get32(payload) / 1000.0,
+		(int16_t)get16(payload + 4) / (double)TELEMETRY_TEMPER_SCALE,
+		(int16_t)get16(payload + 6) / (double)TELEMETRY_TEMPER_SCALE,
+		get16(payload + 8), payload[10], payload[11] & TELEMETRY_HEATING ? 1 : 0,
+		get16(payload + 12), get16(payload + 14), seq);
+	fflush(stdout);
+}
+
+/**
+ * @brief consumes complete frames from buf, returns the bytes used
+ */
+static size_t decode(const uint8_t *buf, size_t len)
+{
+	static bool have_seq = false;
+	static uint8_t last_seq;
+	size_t pos = 0;
+
+	while (pos + 2 <= len)
+	{
+		if (buf[pos] != TELEMETRY_SYNC0 || buf[pos + 1] != TELEMETRY_SYNC1)
+		{
+			stats.skipped++;
+			pos++;
+			continue;
+		}
+		if (pos + 3 > len) break;
+		uint8_t size = buf[pos + 2];
+		if (size != TELEMETRY_PAYLOAD)	// not a frame, sync bytes inside other data
+		{
+			stats.skipped++;
+			pos++;
+			continue;
+		}
+		if (pos + TELEMETRY_FRAME > len) break;
+
+		const uint8_t *frame = buf + pos;
+		uint16_t crc = CRC16_INIT;
+		for (size_t i = 2; i < TELEMETRY_FRAME - 2; i++)
+			crc = crc16(crc, frame[i]);
+		if (crc != get16(frame + TELEMETRY_FRAME - 2))
+		{
+			stats.crc_errors++;
+			stats.skipped++;
+			pos++;
+			continue;
+		}
+
+		uint8_t seq = frame[3];
+		if (have_seq)
+			stats.lost += (uint8_t)(seq - last_seq - 1);
+		have_seq = true;
+		last_seq = seq;
+		stats.frames++;
+		printFrame(frame + 4, seq);
+		pos += TELEMETRY_FRAME;
+	}
+	return pos;
+}
+
+int main(int argc, char **argv)
+{
+	long baud = 9600;
+	int rate = -1;
+	const char *path = NULL;
+	bool usage = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-b") && i + 1 < argc) baud = atol(argv[++i]);
+		else if (!strcmp(argv[i], "-r") && i + 1 < argc) rate = atoi(argv[++i]);
+		else if (!path && argv[i][0] != '-') path = argv[i];
+		else usage = true;
+	}
+	if (usage || !path || rate > 9)
+	{
+		fprintf(stderr, "usage: %s [-b baud] [-r 0..9] DEVICE|FILE\n", argv[0]);
+		return 2;
+	}
+
+	int fd = open(path, rate >= 0 ? O_RDWR | O_NOCTTY : O_RDONLY | O_NOCTTY);
+	if (fd < 0)
+	{
+		perror(path);
+		return 1;
+	}
+	if (!setupTty(fd, baud))
+	{
+		fprintf(stderr, "%s: cannot set %ld baud\n", path, baud);
+		return 1;
+	}
+	if (rate >= 0)
+	{
+		char cmd[2] = { 't', (char)('0' + rate) };
+		if (write(fd, cmd, 2) != 2) perror("write");
+	}
+
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+	printf("time,T_Bottom,T_Set,OutBottom,ProfilStatus,heating,passes,misses,seq\n");
+
+	uint8_t buf[4096];
+	size_t len = 0;
+	while (!stop)
+	{
+		ssize_t n = read(fd, buf + len, sizeof(buf) - len);
+		if (n <= 0) break;
+		len += n;
+		size_t used = decode(buf, len);
+		memmove(buf, buf + used, len - used);
+		len -= used;
+	}
+	stats.skipped += len;
+	close(fd);
+
+	fprintf(stderr, "%lu frames, %lu lost, %lu crc errors, %lu bytes skipped\n",
+		stats.frames, stats.lost, stats.crc_errors, stats.skipped);
+	return 0;
+}